@@ -43,6 +43,7 @@ uint16_t i[36] = {
 
 Mesh mesh_cube = {
     .indexes_count = 36,
+    .positions_count = 36,
     .pos_indices = &i[0],
     .positions = &ver[0],
     .textCoord = &tex[0]
@@ -10,6 +10,7 @@ uint16_t indices[3000] = {
 
 Mesh pingo_mesh = {
 .indexes_count = 3000,
+.positions_count = 514,
 .pos_indices = &indices[0],
 .positions = &vertices[0],
 };
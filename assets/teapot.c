@@ -3466,6 +3466,7 @@ uint16_t indexes[teapot_vertices] = {
 
 Mesh mesh_teapot = {
     .indexes_count = teapot_vertices,
+    .positions_count = teapot_vertices,
     .positions = &positions[0],
     .pos_indices = &indexes[0]
 };
@@ -7,6 +7,7 @@ uint16_t tex_indices[11484] = {0,1,2,0,2,3,1,0,3,1,3,2,4,1,2,4,2,5,6,7,8,9,10,6,
 
 Mesh viking_mesh = {
 .indexes_count = 11484,
+.positions_count = 2554,
 .pos_indices = &pos_indices[0],
 .tex_indices = &tex_indices[0],
 .positions = &_vert[0],
@@ -54,6 +54,17 @@ void afterRender(Renderer *ren, BackEnd *backEnd) {
     // ...
 }
 
+void afterRenderRects(Renderer *ren, BackEnd *backEnd, const Vec4i *rects, int count) {
+    // Copy only the rows of the damaged rects
+    for (int i = 0; i < count; i++) {
+        Vec4i r = rects[i];
+        for (int y = r.y; y < r.w; y++) {
+            Pixel *row = frameBuffer + rect.x + totalSize.x * (rect.y + y);
+            memcpy(row + r.x, renderBuffer + r.x + y * rect.z, (r.z - r.x) * sizeof(Pixel));
+        }
+    }
+}
+
 Pixel *getFrameBuffer(Renderer *ren, BackEnd *backEnd) {
     return renderBuffer; // Return the render buffer for rendering
 }
@@ -69,6 +80,7 @@ void linuxFramebufferBackEndInit(LinuxFramebufferBackEnd *this, Vec2i size, cons
     this->backend.afterRender = &afterRender;
     this->backend.getFrameBuffer = &getFrameBuffer;
     this->backend.getZetaBuffer = &getZetaBuffer;
+    this->backend.afterRenderRects = &afterRenderRects;
 
     zetaBuffer = malloc(size.x * size.y * sizeof(PingoDepth));
     int fdScreen = open(framebufferDevice, O_RDWR);
@@ -11,38 +11,20 @@
 #include "render/object.h"
 #include "render/pixel.h"
 #include "render/renderer.h"
+#include "render/state.h"
 
 #include "linux_framebuffer_backend.h"
 
 #include "assets/viking.h"
 
 
-Pixel * loadTexture(char * filename, Vec2i size) {
-    Pixel * image = malloc(size.x*size.y*4);
-    FILE * file   = fopen(filename, "rb");
-    if (file == 0) {
-        printf("Error: Could not open file %s\n", filename);
-        exit(-1);
-    }
-    for (int i = 1023; i > 0; i--) {
-    for (int j = 0; j < 1024; j++) {
-            char r, g, b, a;
-            fread(&r, 1, 1, file);
-            fread(&g, 1, 1, file);
-            fread(&b, 1, 1, file);
-            fread(&a, 1, 1, file);
-            image[i*1024 + j] = pixelFromRGBA(r, g, b, a);
-        }
-    }
-    fclose(file);
-    return image;
-}
-
 int main(){
 
-    Pixel * image = loadTexture("./viking.rgba", (Vec2i){1024,1024});
     Texture texture;
-    texture_init(&texture, (Vec2i){1024, 1024}, image);
+    if (texture_init_rgbafile(&texture, (Vec2i){1024, 1024}, "./viking.rgba") != OK) {
+        printf("Error: Could not load ./viking.rgba\n");
+        return -1;
+    }
 
     Material material;
     material_init(&material, &texture);
@@ -14,12 +14,14 @@ Vec2i totalSize;
 
 PingoDepth *zetaBuffer;
 Pixel *frameBuffer;
+Pixel *presentBuffer; // Flipped copy of the damaged rects of frameBuffer
 
 Display *dis = 0;
 int screen;
 Window win;
 GC gc;
 XImage *img = 0;
+XImage *presentImg = 0;
 Visual *visual;
 
 void init_x()
@@ -59,9 +61,9 @@ void beforeRender(Renderer *ren, Backend *Backend)
     LinuxWindowBackend *this = (LinuxWindowBackend *) Backend;
 }
 
-XImage *create_ximage(Display *display, Visual *visual, int width, int height)
+XImage *create_ximage(Display *display, Visual *visual, int width, int height, Pixel *pixels)
 {
-    return XCreateImage(display, visual, 24, ZPixmap, 0, (char *) &frameBuffer[0], width, height, 32, 0);
+    return XCreateImage(display, visual, 24, ZPixmap, 0, (char *) &pixels[0], width, height, 32, 0);
 }
 
 void texture_flip_vertically(Texture *f) {
@@ -94,8 +96,9 @@ void texture_flip_vertically(Texture *f) {
 void afterRender(Renderer *ren, Backend *Backend)
 {
     if (!img) {
-        img = create_ximage(dis, visual, totalSize.x, totalSize.y);
+        img = create_ximage(dis, visual, totalSize.x, totalSize.y, frameBuffer);
     }
+    img->data = (char *) ren->framebuffer.frameBuffer;
 
     texture_flip_vertically(&ren->framebuffer);
     XEvent event;
@@ -105,6 +108,32 @@ void afterRender(Renderer *ren, Backend *Backend)
     XFlush(dis);
 }
 
+// The framebuffer keeps its content between frames, so it is flipped into a
+// separate image, and only the damaged rects are
+void afterRenderRects(Renderer *ren, Backend *Backend, const Vec4i *rects, int count)
+{
+    if (!presentImg) {
+        presentBuffer = calloc(totalSize.x * totalSize.y, sizeof(Pixel));
+        presentImg = create_ximage(dis, visual, totalSize.x, totalSize.y, presentBuffer);
+    }
+
+    XEvent event;
+    XNextEvent(dis, &event);
+    XClearArea(dis, win, 0, 0, 1, 1, true);
+
+    for (int i = 0; i < count; i++) {
+        Vec4i r = rects[i];
+        int width = r.z - r.x;
+        for (int y = r.y; y < r.w; y++) {
+            int flipped = totalSize.y - 1 - y;
+            memcpy(&presentBuffer[r.x + flipped * totalSize.x], &frameBuffer[r.x + y * totalSize.x], width * sizeof(Pixel));
+        }
+        int top = totalSize.y - r.w;
+        XPutImage(dis, win, gc, presentImg, r.x, top, r.x, top, width, r.w - r.y);
+    }
+    XFlush(dis);
+}
+
 Pixel *getFrameBuffer(Renderer *ren, Backend *Backend)
 {
     return frameBuffer;
@@ -123,6 +152,7 @@ void linuxWindowBackendInit(LinuxWindowBackend *this, Vec2i size)
     this->backend.afterRender = &afterRender;
     this->backend.getFrameBuffer = &getFrameBuffer;
     this->backend.getZetaBuffer = &getZetaBuffer;
+    this->backend.afterRenderRects = &afterRenderRects;
 
     zetaBuffer = malloc(size.x * size.y * sizeof(PingoDepth));
     frameBuffer = malloc(size.x * size.y * sizeof(Pixel));
@@ -2,12 +2,15 @@
 #include "assets/viking.h"
 #include "linux_window_backend.h"
 
+#include "render/damage.h"
 #include "render/entity.h"
 #include "render/material.h"
 #include "render/mesh.h"
 #include "render/object.h"
 #include "render/pixel.h"
 #include "render/renderer.h"
+#include "render/state.h"
+#include "render/vertex.h"
 
 #include <math.h>
 #include <stdio.h>
@@ -15,33 +18,13 @@
 #include <unistd.h>
 
 
-Pixel * loadTexture(char * filename, Vec2i size) {
-    Pixel * image = malloc(size.x*size.y*4);
-    FILE * file   = fopen(filename, "rb");
-    if (file == 0) {
-        printf("Error: Could not open file %s\n", filename);
-        exit(-1);
-    }
-    for (int i = 1023; i > 0; i--) {
-    for (int j = 0; j < 1024; j++) {
-            char r, g, b, a;
-            fread(&r, 1, 1, file);
-            fread(&g, 1, 1, file);
-            fread(&b, 1, 1, file);
-            fread(&a, 1, 1, file);
-            image[i*1024 + j] = pixelFromRGBA(r, g, b, a);
-        }
-    }
-    fclose(file);
-    return image;
-}
-
 int main(){
 
-    Pixel * image = loadTexture("assets/viking.rgba", (Vec2i){1024,1024});
-
     Texture texture;
-    texture_init(&texture, (Vec2i){1024, 1024}, image);
+    if (texture_init_rgbafile(&texture, (Vec2i){1024, 1024}, "assets/viking.rgba") != OK) {
+        printf("Error: Could not load assets/viking.rgba\n");
+        return -1;
+    }
 
     Material material;
     material_init(&material, &texture);
@@ -60,6 +43,12 @@ int main(){
     Renderer renderer;
     renderer_init(&renderer, size, (Backend*)&backend );
     renderer_set_root_renderable(&renderer, (Renderable*)&root_entity);
+    renderer_set_vertex_cache(&renderer, malloc(4096 * sizeof(Vertex)), 4096);
+
+    //Only the part of the window the model covers is cleared and presented
+    Damage damage;
+    damage_init(&damage, size);
+    renderer_set_damage(&renderer, &damage);
 
     float phi = 0;
     Mat4 t;
@@ -2,6 +2,7 @@
 
 #include "render/depth.h"
 #include "render/pixel.h"
+#include "render/renderer.h"
 #include "render/state.h"
 
 #include <stdio.h>
@@ -52,23 +53,41 @@ void jpbe_afterRender(Renderer *ren, Backend *Backend)
 
   jpeg_start_compress(&cinfo, TRUE);
 
-  JSAMPROW row_pointer[1];
+  // Pixels are converted to RGB a row at a time, whatever their format
+  JSAMPLE *row = malloc(imageSize.x * 3);
+  JSAMPROW row_pointer[1] = {row};
   while (cinfo.next_scanline < cinfo.image_height) {
-      row_pointer[0] = &frameBuffer[cinfo.next_scanline * imageSize.x];
+      Pixel *pixels = &ren->framebuffer.frameBuffer[cinfo.next_scanline * imageSize.x];
+      for (int x = 0; x < imageSize.x; x++) {
+          uint32_t rgba = pixelToRGBA(&pixels[x]);
+          row[x * 3] = rgba & 0xFF;
+          row[x * 3 + 1] = (rgba >> 8) & 0xFF;
+          row[x * 3 + 2] = (rgba >> 16) & 0xFF;
+      }
       jpeg_write_scanlines(&cinfo, row_pointer, 1);
   }
+  free(row);
 
   jpeg_finish_compress(&cinfo);
   fclose(jpegFile);
   jpeg_destroy_compress(&cinfo);
 }
 
+// A JPEG is always encoded whole, the damage only tells whether the image
+// changed at all
+void jpbe_afterRenderRects(Renderer *ren, Backend *Backend, const Vec4i *rects, int count)
+{
+  if (count > 0)
+    jpbe_afterRender(ren, Backend);
+}
+
 int jpeg_backend_init(JpegBackend *this, Vec2i size, const char *filename) {
   this->backend.init = &jpbe_init;
   this->backend.beforeRender = &jpbe_beforeRender;
   this->backend.afterRender = &jpbe_afterRender;
   this->backend.getFrameBuffer = &jpbe_getFrameBuffer;
   this->backend.getZetaBuffer = &jpbe_getZetaBuffer;
+  this->backend.afterRenderRects = &jpbe_afterRenderRects;
 
   if (filename == NULL) {
     return INIT_ERROR; // Allocation failed
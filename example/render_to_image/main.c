@@ -4,11 +4,17 @@
 #include "jpeg_backend.h"
 
 #include "render/entity.h"
+#include "render/lod.h"
 #include "render/material.h"
 #include "render/mesh.h"
+#include "render/meshlet.h"
 #include "render/object.h"
 #include "render/pixel.h"
 #include "render/renderer.h"
+#include "render/state.h"
+#include "render/swapchain.h"
+#include "render/vertex.h"
+#include "render/tiler.h"
 
 #include <math.h>
 #include <stdio.h>
@@ -16,51 +22,74 @@
 #include <unistd.h>
 
 
-Pixel * loadTexture(char * filename, Vec2i size) {
-    Pixel * image = malloc(size.x*size.y*4);
-    FILE * file   = fopen(filename, "rb");
-    if (file == 0) {
-        printf("Error: Could not open file %s\n", filename);
-        exit(-1);
-    }
-    for (int i = 1023; i > 0; i--) {
-    for (int j = 0; j < 1024; j++) {
-            char r, g, b, a;
-            fread(&r, 1, 1, file);
-            fread(&g, 1, 1, file);
-            fread(&b, 1, 1, file);
-            fread(&a, 1, 1, file);
-            image[i*1024 + j] = pixelFromRGBA(r, g, b, a);
-        }
-    }
-    fclose(file);
-    return image;
-}
-
 int main(){
 
-    Pixel * image = loadTexture("assets/viking.rgba", (Vec2i){1024,1024});
-
     Texture texture;
-    texture_init(&texture, (Vec2i){1024, 1024}, image);
+    if (texture_init_rgbafile(&texture, (Vec2i){1024, 1024}, "assets/viking.rgba") != OK) {
+        printf("Error: Could not load assets/viking.rgba\n");
+        return -1;
+    }
+
+    // The model is mostly seen from afar, sample it from smaller levels
+    texture_build_mipmaps(&texture, malloc(TEXTURE_MIPMAPS_SIZE(1024, 1024) * sizeof(Pixel)));
+    texture_set_filter(&texture, TEXTURE_TRILINEAR);
 
     Material material;
     material_init(&material, &texture);
 
-    Object object;
-    object_init(&object, &viking_mesh, &material);
+    // Split the model in clusters that can be culled as a whole
+    static Meshlet meshlets[MESHLETS_COUNT_MAX(11484)];
+    mesh_build_meshlets(&viking_mesh, meshlets, MESHLETS_COUNT_MAX(11484),
+                        malloc(viking_mesh.indexes_count / 3 * sizeof(uint32_t)));
+
+    // Simplified versions of the model, drawn when they are off by less than
+    // a pixel
+    int positions = mesh_positions_count(&viking_mesh);
+    Mesh lod_meshes[4];
+    float lod_errors[4];
+    mesh_build_lods(&viking_mesh, lod_meshes, lod_errors, 4,
+                    malloc(MESH_LODS_INDICES(viking_mesh.indexes_count) * sizeof(uint16_t)),
+                    malloc(MESH_LODS_POSITIONS(positions) * sizeof(Vec3f)),
+                    malloc(MESH_LODS_SCRATCH_SIZE(positions, viking_mesh.indexes_count)));
+
+    Object objects[4];
+    for (int i = 0; i < 4; i++)
+        object_init(&objects[i], &lod_meshes[i], &material);
+
+    Lod lod;
+    lod_init(&lod, objects, lod_errors, 4, 1);
 
     Entity root_entity;
-    entity_init(&root_entity, (Renderable*)&object, mat4Identity());
+    entity_init(&root_entity, (Renderable*)&lod, mat4Identity());
 
 
     Vec2i size = {640, 480};
     JpegBackend jpegBackend;
     jpeg_backend_init(&jpegBackend, size, "out.jpeg");
 
+    // Encode each frame on another thread while the next one is rasterized
+    Pixel *buffers[2] = {malloc(size.x * size.y * sizeof(Pixel)),
+                         malloc(size.x * size.y * sizeof(Pixel))};
+    Swapchain swapchain;
+    swapchain_init(&swapchain, (Backend*)&jpegBackend, buffers, 2,
+                   malloc(size.x * size.y * sizeof(PingoDepth)));
+
     Renderer renderer;
-    renderer_init(&renderer, size, (Renderable*)&jpegBackend );
+    renderer_init(&renderer, size, (Backend*)&swapchain );
     renderer_set_root_renderable(&renderer, (Renderable*)&root_entity);
+    renderer_set_vertex_cache(&renderer, malloc(4096 * sizeof(Vertex)), 4096);
+
+    // Draw the faces of the model nearest first
+    renderer_set_face_sort(&renderer, malloc(4096 * sizeof(uint16_t)), malloc(4096), 4096);
+
+    // Bin triangles in screen tiles and rasterize them on 8 threads
+    Tiler tiler;
+    tiler_init(&tiler, size,
+               malloc(TILER_BINS_COUNT(size.x, size.y) * sizeof(TilerBin)),
+               malloc(4096 * sizeof(Triangle)), 4096,
+               malloc(16384 * sizeof(TilerEntry)), 16384,
+               8);
+    renderer_set_tiler(&renderer, &tiler);
 
     float phi = 0;
     Mat4 t;
@@ -12,22 +12,6 @@
 #include <stdlib.h>
 #include <math.h>
 
-Pixel * loadTexture(char * filename, Vec2i size) {
-    //Load from filesystem from a RAW RGBA file
-    Pixel * image = malloc(size.x*size.y*4);
-    FILE * file   = fopen(filename, "rb");
-    for (int i = 1023; i > 0; i--) {
-    for (int j = 0; j < 1024; j++) {
-            fread(&image[i*1024 + j].r, 1, 1, file);
-            fread(&image[i*1024 + j].g, 1, 1, file);
-            fread(&image[i*1024 + j].b, 1, 1, file);
-            fread(&image[i*1024 + j].a, 1, 1, file);
-        }
-    }
-    fclose(file);
-    return image;
-}
-
 int main(){
     Vec2i size = {1280, 800};
 
@@ -46,10 +30,8 @@ int main(){
     sceneAddRenderable(&s, object_as_renderable(&viking_room));
     viking_room.material = 0;
 
-    Pixel * image = loadTexture("texture.data", (Vec2i){1024,1024});
-
     Texture tex;
-    texture_init(&tex, (Vec2i){1024,1024},image);
+    texture_init_rgbafile(&tex, (Vec2i){1024,1024}, "texture.data");
 
     Material m;
     m.texture = &tex;
@@ -18,7 +18,7 @@ typedef struct Backend {
   // Called before starting rendering
   void (*beforeRender)(Renderer *, struct Backend *);
 
-  // Called after having finished a render
+  // Called after having finished a render, presents ren->framebuffer
   void (*afterRender)(Renderer *, struct Backend *);
 
   // Should return the address of the buffer (height*width*sizeof(Pixel))
@@ -26,4 +26,9 @@ typedef struct Backend {
 
   // Should return the address of the buffer (height*width*sizeof(Pixel))
   PingoDepth *(*getZetaBuffer)(Renderer *, struct Backend *);
+
+  // Optional, called instead of afterRender when the renderer tracks damage
+  // (see damage.h): only the count rects may have changed since the last
+  // present
+  void (*afterRenderRects)(Renderer *, struct Backend *, const Vec4i *rects, int count);
 } Backend;
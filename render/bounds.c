@@ -0,0 +1,82 @@
+#include "bounds.h"
+
+#include <math.h>
+
+Sphere sphere_transform(Sphere s, Mat4 *m)
+{
+    if (s.radius < 0)
+        return s;
+
+    Vec4f c = {s.center.x, s.center.y, s.center.z, 1};
+    c = mat4MultiplyVec4(&c, m);
+
+    float scale = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        float x = m->elements[axis];
+        float y = m->elements[axis + 4];
+        float z = m->elements[axis + 8];
+        float l = x * x + y * y + z * z;
+        if (l > scale)
+            scale = l;
+    }
+
+    return (Sphere){{c.x, c.y, c.z}, s.radius * sqrtf(scale)};
+}
+
+Sphere sphere_merge(Sphere a, Sphere b)
+{
+    if (a.radius < 0 || b.radius < 0)
+        return SPHERE_UNBOUNDED;
+
+    Vec3f d = vec3fsubV(b.center, a.center);
+    float distance = sqrtf(vec3Dot(d, d));
+
+    //One sphere contains the other
+    if (distance + b.radius <= a.radius)
+        return a;
+    if (distance + a.radius <= b.radius)
+        return b;
+
+    float radius = (distance + a.radius + b.radius) * 0.5f;
+    Vec3f center = vec3fsumV(a.center, vec3fmul(d, (radius - a.radius) / distance));
+    return (Sphere){center, radius};
+}
+
+Frustum frustum_from_projection(Mat4 *projection)
+{
+    const F_TYPE *p = projection->elements;
+    Frustum f;
+
+    for (int i = 0; i < 6; i++) {
+        //Rows x, y and z of the projection, added to then subtracted from w
+        int row = (i / 2) * 4;
+        float sign = (i % 2) == 0 ? 1 : -1;
+        Vec4f plane = {p[12] + sign * p[row + 0],
+                       p[13] + sign * p[row + 1],
+                       p[14] + sign * p[row + 2],
+                       p[15] + sign * p[row + 3]};
+
+        float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        if (length > 0)
+            plane = (Vec4f){plane.x / length, plane.y / length, plane.z / length, plane.w / length};
+        f.planes[i] = plane;
+    }
+
+    return f;
+}
+
+bool frustum_cull_sphere(const Frustum *f, Sphere s)
+{
+    if (s.radius < 0)
+        return false;
+
+    for (int i = 0; i < 6; i++) {
+        const Vec4f *plane = &f->planes[i];
+        float distance = plane->x * s.center.x + plane->y * s.center.y +
+                         plane->z * s.center.z + plane->w;
+        if (distance < -s.radius)
+            return true;
+    }
+
+    return false;
+}
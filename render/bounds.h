@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "math/mat4.h"
+#include "math/vec3.h"
+#include "math/vec4.h"
+
+/**
+ * Bounding spheres and frustum culling.
+ *
+ * A sphere with a negative radius is unbounded: it can never be culled and
+ * merging anything with it stays unbounded.
+ */
+
+typedef struct Sphere {
+  Vec3f center;
+  float radius;
+} Sphere;
+
+#define SPHERE_UNBOUNDED ((Sphere){{0, 0, 0}, -1})
+
+/// The six planes of a frustum as {nx, ny, nz, d}, normals of unit length
+/// pointing inside
+typedef struct Frustum {
+  Vec4f planes[6];
+} Frustum;
+
+/// Sphere in the space m transforms into. The radius is scaled by the
+/// largest axis scale of m
+extern Sphere sphere_transform(Sphere s, Mat4 *m);
+
+/// Smallest sphere enclosing a and b
+extern Sphere sphere_merge(Sphere a, Sphere b);
+
+/// View space frustum of a projection matrix, from its -w <= x, y, z <= w
+/// clip planes
+extern Frustum frustum_from_projection(Mat4 *projection);
+
+/// True when the sphere lies entirely outside one of the planes
+extern bool frustum_cull_sphere(const Frustum *f, Sphere s);
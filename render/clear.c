@@ -0,0 +1,77 @@
+#include "clear.h"
+#include "backend.h"
+#include "depth.h"
+#include "math/fun.h"
+#include "renderer.h"
+
+#include <string.h>
+
+static int32_t clear_stride(Renderer *r)
+{
+    return (r->framebuffer.size.x + DEPTH_HIZ_TILE - 1) / DEPTH_HIZ_TILE;
+}
+
+void clear_begin(Renderer *r)
+{
+    int blocks = DEPTH_HIZ_SIZE(r->framebuffer.size.x, r->framebuffer.size.y);
+    for (int i = 0; i < blocks; i++)
+        r->clear_blocks[i] = r->clear_blocks[i] & (CLEAR_TOUCHED | CLEAR_DIRTY) ? CLEAR_DIRTY : 0;
+}
+
+// Clears the color of a block, and its depth as well when depth is set
+static void clear_pixels(Renderer *r, int32_t bx, int32_t by, bool depth)
+{
+    const Vec2i size = r->framebuffer.size;
+    int32_t x0 = bx * DEPTH_HIZ_TILE;
+    int32_t y0 = by * DEPTH_HIZ_TILE;
+    int32_t w = MIN(DEPTH_HIZ_TILE, size.x - x0);
+    int32_t h = MIN(DEPTH_HIZ_TILE, size.y - y0);
+
+    if (r->clear) {
+        for (int32_t y = y0; y < y0 + h; y++)
+            memset(&r->framebuffer.frameBuffer[x0 + y * size.x], 0, w * sizeof(Pixel));
+    }
+
+    if (depth) {
+        int bytes = depth_format_size(r->depth_format);
+        uint8_t *zeta = (uint8_t *)r->backend->getZetaBuffer(r, r->backend);
+        for (int32_t y = y0; y < y0 + h; y++)
+            memset(&zeta[(x0 + y * size.x) * bytes], 0, w * bytes);
+    }
+}
+
+void clear_block(Renderer *r, int32_t bx, int32_t by)
+{
+    clear_pixels(r, bx, by, true);
+    r->clear_blocks[bx + by * clear_stride(r)] = CLEAR_TOUCHED;
+}
+
+void clear_rect(Renderer *r, Vec4i rect)
+{
+    if (r->clear_blocks == 0 || rect.x >= rect.z || rect.y >= rect.w)
+        return;
+
+    int32_t stride = clear_stride(r);
+    for (int32_t by = rect.y / DEPTH_HIZ_TILE; by <= (rect.w - 1) / DEPTH_HIZ_TILE; by++) {
+        for (int32_t bx = rect.x / DEPTH_HIZ_TILE; bx <= (rect.z - 1) / DEPTH_HIZ_TILE; bx++) {
+            if ((r->clear_blocks[bx + by * stride] & CLEAR_TOUCHED) == 0)
+                clear_block(r, bx, by);
+        }
+    }
+}
+
+void clear_end(Renderer *r)
+{
+    int32_t stride = clear_stride(r);
+    int32_t rows = (r->framebuffer.size.y + DEPTH_HIZ_TILE - 1) / DEPTH_HIZ_TILE;
+
+    for (int32_t by = 0; by < rows; by++) {
+        for (int32_t bx = 0; bx < stride; bx++) {
+            uint8_t *state = &r->clear_blocks[bx + by * stride];
+            if (*state == CLEAR_DIRTY) {
+                clear_pixels(r, bx, by, false);
+                *state = 0;
+            }
+        }
+    }
+}
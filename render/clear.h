@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "math/vec4.h"
+
+typedef struct Renderer Renderer;
+
+/**
+ * Lazy clear of the depth and color buffers.
+ *
+ * Instead of clearing both buffers at the start of every frame, the renderer
+ * keeps a state per DEPTH_HIZ_TILE x DEPTH_HIZ_TILE block of the screen, and
+ * a block is cleared when a triangle or a sprite first draws into it during
+ * the frame. Blocks nothing draws into keep a stale depth, which is never
+ * read, and their color is only cleared at the end of the frame when an
+ * earlier frame drew into them. A static scene over a small part of the
+ * screen then clears that part and nothing else.
+ *
+ * A block is only ever touched by the thread rasterizing the tile holding
+ * it, the states need no locking.
+ */
+
+#define CLEAR_TOUCHED 0x01 // Cleared during the current frame
+#define CLEAR_DIRTY 0x02   // Color drawn by an earlier frame
+
+/// Starts a frame: every block becomes untouched
+extern void clear_begin(Renderer *r);
+
+/// Clears the block bx/by, in blocks, and marks it touched
+extern void clear_block(Renderer *r, int32_t bx, int32_t by);
+
+/// Clears the blocks of a pixel rect ({minX, minY, maxX, maxY}, max excluded)
+/// not cleared yet during the frame
+extern void clear_rect(Renderer *r, Vec4i rect);
+
+/// Ends a frame: clears the color of the blocks an earlier frame drew into
+/// and the current one did not
+extern void clear_end(Renderer *r);
+
@@ -0,0 +1,76 @@
+#include "clip.h"
+
+#define CLIP_PLANES 6
+
+Vec2f clip_guard(Vec2i screen)
+{
+    return (Vec2f){(float)CLIP_GUARD_BAND / (screen.x / 2),
+                   (float)CLIP_GUARD_BAND / (screen.y / 2)};
+}
+
+uint8_t clip_flags(Vec4f p, Vec2f guard)
+{
+    uint8_t flags = 0;
+    if (p.x < -p.w) flags |= CLIP_LEFT;
+    if (p.x > p.w) flags |= CLIP_RIGHT;
+    if (p.y < -p.w) flags |= CLIP_BOTTOM;
+    if (p.y > p.w) flags |= CLIP_TOP;
+    if (p.z < -p.w) flags |= CLIP_NEAR;
+    if (p.z > p.w) flags |= CLIP_FAR;
+    if (p.w < CLIP_W_MIN) flags |= CLIP_BEHIND;
+    if (p.x < -guard.x * p.w || p.x > guard.x * p.w ||
+        p.y < -guard.y * p.w || p.y > guard.y * p.w)
+        flags |= CLIP_GUARD;
+    return flags;
+}
+
+// Signed distance from a plane, positive on the inner side
+static float clip_distance(const Vec4f *p, int plane, Vec2f guard)
+{
+    switch (plane) {
+    case 0: return p->z + p->w;
+    case 1: return p->w - CLIP_W_MIN;
+    case 2: return p->x + guard.x * p->w;
+    case 3: return guard.x * p->w - p->x;
+    case 4: return p->y + guard.y * p->w;
+    default: return guard.y * p->w - p->y;
+    }
+}
+
+static ClipVertex clip_lerp(const ClipVertex *a, const ClipVertex *b, float t)
+{
+    ClipVertex out;
+    out.clip.x = a->clip.x + (b->clip.x - a->clip.x) * t;
+    out.clip.y = a->clip.y + (b->clip.y - a->clip.y) * t;
+    out.clip.z = a->clip.z + (b->clip.z - a->clip.z) * t;
+    out.clip.w = a->clip.w + (b->clip.w - a->clip.w) * t;
+    out.uv.x = a->uv.x + (b->uv.x - a->uv.x) * t;
+    out.uv.y = a->uv.y + (b->uv.y - a->uv.y) * t;
+    return out;
+}
+
+int clip_polygon(ClipVertex *poly, int count, Vec2f guard)
+{
+    ClipVertex tmp[CLIP_MAX_VERTICES];
+
+    // Sutherland-Hodgman, one plane at a time
+    for (int plane = 0; plane < CLIP_PLANES && count >= 3; plane++) {
+        int out = 0;
+        for (int i = 0; i < count; i++) {
+            ClipVertex *a = &poly[i];
+            ClipVertex *b = &poly[(i + 1) % count];
+            float da = clip_distance(&a->clip, plane, guard);
+            float db = clip_distance(&b->clip, plane, guard);
+
+            if (da >= 0)
+                tmp[out++] = *a;
+            if ((da >= 0) != (db >= 0))
+                tmp[out++] = clip_lerp(a, b, da / (da - db));
+        }
+        for (int i = 0; i < out; i++)
+            poly[i] = tmp[i];
+        count = out;
+    }
+
+    return count >= 3 ? count : 0;
+}
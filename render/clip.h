@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "math/vec2.h"
+#include "math/vec4.h"
+
+/**
+ * Clip space frustum tests and polygon clipping.
+ *
+ * Each vertex gets a set of flags telling which clip planes it lies outside.
+ * A triangle whose vertices are all outside the same frustum plane is
+ * trivially rejected. A triangle with a vertex in front of the near plane,
+ * behind the camera or outside the guard band is clipped in homogeneous
+ * coordinates, everything else is rasterized as is: the rasterizer already
+ * clamps to the screen, the guard band only has to keep the screen space
+ * coordinates small enough for the integer edge functions.
+ */
+
+#define CLIP_LEFT 0x01   // x < -w
+#define CLIP_RIGHT 0x02  // x > w
+#define CLIP_BOTTOM 0x04 // y < -w
+#define CLIP_TOP 0x08    // y > w
+#define CLIP_NEAR 0x10   // z < -w
+#define CLIP_FAR 0x20    // z > w
+#define CLIP_BEHIND 0x40 // w < CLIP_W_MIN
+#define CLIP_GUARD 0x80  // Outside of the guard band
+
+#define CLIP_FRUSTUM 0x7F
+#define CLIP_NEEDED (CLIP_NEAR | CLIP_BEHIND | CLIP_GUARD)
+
+#define CLIP_W_MIN 1e-5f
+
+// Half size of the guard band, in pixels around the screen center
+#define CLIP_GUARD_BAND 8192
+
+// A triangle clipped against all the planes can get one vertex per plane
+#define CLIP_MAX_VERTICES 9
+
+typedef struct ClipVertex {
+  Vec4f clip;
+  Vec2f uv;
+} ClipVertex;
+
+/// Guard band half size in normalized device units for a screen
+extern Vec2f clip_guard(Vec2i screen);
+
+/// Flags of the planes the clip space position lies outside of
+extern uint8_t clip_flags(Vec4f p, Vec2f guard);
+
+/// Clips a convex polygon against the near plane and the guard band.
+/// poly must have room for CLIP_MAX_VERTICES, returns the new vertex count.
+extern int clip_polygon(ClipVertex *poly, int count, Vec2f guard);
@@ -0,0 +1,91 @@
+#include "damage.h"
+#include "backend.h"
+#include "depth.h"
+#include "math/fun.h"
+#include "renderer.h"
+#include "state.h"
+
+#include <string.h>
+
+static int64_t damage_area(Vec4i r)
+{
+    return (int64_t)(r.z - r.x) * (r.w - r.y);
+}
+
+static Vec4i damage_union(Vec4i a, Vec4i b)
+{
+    return (Vec4i){MIN(a.x, b.x), MIN(a.y, b.y), MAX(a.z, b.z), MAX(a.w, b.w)};
+}
+
+int damage_init(Damage *this, Vec2i size)
+{
+    IF_NULL_RETURN(this, INIT_ERROR);
+
+    this->size = size;
+    this->drawn.count = 0;
+    this->present.count = 0;
+    this->previous.count = 0;
+    damage_region_add(&this->previous, (Vec4i){0, 0, size.x, size.y});
+
+    return OK;
+}
+
+void damage_region_add(DamageRegion *region, Vec4i rect)
+{
+    if (rect.x >= rect.z || rect.y >= rect.w)
+        return;
+
+    //Find the rect growing the least when rect is merged into it
+    int best = -1;
+    int64_t bestGrowth = 0;
+    for (int i = 0; i < region->count; i++) {
+        Vec4i merged = damage_union(region->rects[i], rect);
+        int64_t growth = damage_area(merged) - damage_area(region->rects[i]);
+        if (best < 0 || growth < bestGrowth) {
+            best = i;
+            bestGrowth = growth;
+        }
+    }
+
+    //Merge when the union covers no more than both rects apart, or when
+    //there is no room left
+    if (best >= 0 && (bestGrowth <= damage_area(rect) || region->count == DAMAGE_RECTS_MAX)) {
+        region->rects[best] = damage_union(region->rects[best], rect);
+        return;
+    }
+
+    region->rects[region->count++] = rect;
+}
+
+void damage_begin(Damage *this, Renderer *r)
+{
+    Backend *be = r->backend;
+    Pixel *frame = be->getFrameBuffer(r, be);
+    uint8_t *zeta = (uint8_t *)be->getZetaBuffer(r, be);
+    int bytes = depth_format_size(r->depth_format);
+
+    //The lazy clear, when set, clears on its own
+    if (r->clear_blocks == 0) {
+        for (int i = 0; i < this->previous.count; i++) {
+            Vec4i rect = this->previous.rects[i];
+            int32_t w = rect.z - rect.x;
+            for (int32_t y = rect.y; y < rect.w; y++) {
+                int32_t idx = rect.x + y * this->size.x;
+                if (r->clear)
+                    memset(&frame[idx], 0, w * sizeof(Pixel));
+                memset(&zeta[idx * bytes], 0, w * bytes);
+            }
+        }
+    }
+
+    this->drawn.count = 0;
+}
+
+void damage_end(Damage *this)
+{
+    this->present = this->drawn;
+    for (int i = 0; i < this->previous.count; i++)
+        damage_region_add(&this->present, this->previous.rects[i]);
+
+    this->previous = this->drawn;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "math/vec2.h"
+#include "math/vec4.h"
+
+typedef struct Renderer Renderer;
+
+/**
+ * Dirty rectangles.
+ *
+ * When a damage tracker is set on the renderer, the screen bounds of every
+ * triangle and sprite drawn are accumulated into a few rectangles. At the
+ * start of a frame only the rectangles drawn by the previous frame are
+ * cleared: everything else is still clear. At the end of the frame the
+ * rectangles of both frames, the region that may have changed, are handed
+ * to the backend afterRenderRects hook so that it only presents them.
+ *
+ * The buffers must keep their content from one frame to the next, the
+ * backend has to return the same buffers every frame and not modify them.
+ */
+
+#define DAMAGE_RECTS_MAX 8
+
+// Rectangles as {minX, minY, maxX, maxY}, max excluded. They may overlap
+typedef struct DamageRegion {
+  Vec4i rects[DAMAGE_RECTS_MAX];
+  int count;
+} DamageRegion;
+
+typedef struct Damage {
+  Vec2i size;
+  DamageRegion drawn;    // Drawn by the current frame
+  DamageRegion previous; // Drawn by the previous frame
+  DamageRegion present;  // Both, handed to the backend
+} Damage;
+
+/// The first frame clears and presents the whole screen
+extern int damage_init(Damage *this, Vec2i size);
+
+/// Adds a rect to a region. Once the region is full, the rect is merged
+/// into the one it grows the least
+extern void damage_region_add(DamageRegion *region, Vec4i rect);
+
+/// Starts a frame: clears the color and depth drawn by the previous frame
+extern void damage_begin(Damage *this, Renderer *r);
+
+/// Ends a frame: computes the region to present
+extern void damage_end(Damage *this);
@@ -1,32 +1,77 @@
 #include "depth.h"
 
-#ifdef ZBUFFER32
-void depth_write (PingoDepth * d, int idx, float value) {
-    d[idx].d = (uint32_t)(value * (float)UINT32_MAX);
-}
-
-bool depth_check(PingoDepth * d, int idx, float value){
-    return (uint32_t)(value * (float)UINT32_MAX) < d[idx].d;
+int depth_format_size(DepthFormat format)
+{
+    switch (format) {
+    case DEPTH_16:
+        return sizeof(uint16_t);
+    case DEPTH_8:
+        return sizeof(uint8_t);
+    case DEPTH_FLOAT:
+        return sizeof(float);
+    default:
+        return sizeof(uint32_t);
+    }
 }
-#endif
 
-#ifdef ZBUFFER16
 void depth_write (PingoDepth * d, int idx, float value) {
-    d[idx].d = (uint16_t)(value * UINT16_MAX);
+    d[idx].d = depth_encode32(value);
 }
 
 bool depth_check(PingoDepth * d, int idx, float value){
-    return (uint16_t)(value * UINT16_MAX) < d[idx].d;
+    return depth_encode32(value) < d[idx].d;
 }
-#endif
 
-#ifdef ZBUFFER8
-void depth_write (PingoDepth * d, int idx, float value) {
-    d[idx].d = (uint8_t)(value * UINT8_MAX);
+bool depth_hiz_reject(DepthFormat format, PingoDepth * hiz, int idx, float value){
+    switch (format) {
+    case DEPTH_16:
+        if (value < 0 || value > 1.0)
+            return false;
+        return depth_encode16(value) < hiz[idx].d;
+    case DEPTH_8:
+        if (value < 0 || value > 1.0)
+            return false;
+        return depth_encode8(value) < hiz[idx].d;
+    case DEPTH_FLOAT:
+        return value < ((float *)hiz)[idx];
+    default:
+        if (value < 0 || value >= 1.0)
+            return false;
+        return depth_encode32(value) < hiz[idx].d;
+    }
 }
 
-bool depth_check(PingoDepth * d, int idx, float value){
-    return (uint8_t)(value * UINT8_MAX) > d[idx].d;
-}
-#endif
+// Smallest value of a block, for each integer format
+#define DEPTH_FARTHEST(type, max)                                              \
+    do {                                                                       \
+        const type *p = (const type *)d + idx;                                 \
+        uint32_t farthest = max;                                               \
+        for (int y = 0; y < h; y++)                                            \
+            for (int x = 0; x < w; x++)                                        \
+                farthest = p[x + y * stride] < farthest ? p[x + y * stride] : farthest; \
+        hiz[hizIdx].d = farthest;                                              \
+    } while (0)
 
+void depth_hiz_update(DepthFormat format, PingoDepth * hiz, int hizIdx,
+                      PingoDepth * d, int idx, int stride, int w, int h){
+    switch (format) {
+    case DEPTH_16:
+        DEPTH_FARTHEST(uint16_t, UINT16_MAX);
+        break;
+    case DEPTH_8:
+        DEPTH_FARTHEST(uint8_t, UINT8_MAX);
+        break;
+    case DEPTH_FLOAT: {
+        const float *p = (const float *)d + idx;
+        float farthest = p[0];
+        for (int y = 0; y < h; y++)
+            for (int x = 0; x < w; x++)
+                farthest = p[x + y * stride] < farthest ? p[x + y * stride] : farthest;
+        ((float *)hiz)[hizIdx] = farthest;
+        break;
+    }
+    default:
+        DEPTH_FARTHEST(uint32_t, UINT32_MAX);
+        break;
+    }
+}
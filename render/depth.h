@@ -3,25 +3,61 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-#define ZBUFFER32 // [ZBUFFER32 | ZBUFFER16 | ZBUFFER8]
+/**
+ * Depth buffer formats, chosen per renderer at runtime.
+ *
+ * Every format stores larger values for nearer fragments and a cleared
+ * buffer (all bits 0) is infinitely far. The fixed point formats store the
+ * negated device depth scaled to their range. DEPTH_FLOAT stores 1 / w, the
+ * reversed-Z layout: values go to 0 with the distance, where the float
+ * exponent keeps their precision, instead of bunching up near 1.
+ *
+ * Depth buffers are arrays of PingoDepth, whose size fits the largest
+ * format. The smaller formats use the start of the same memory, packed.
+ */
+
+typedef enum DepthFormat {
+  DEPTH_32,    // uint32_t
+  DEPTH_16,    // uint16_t, half the bandwidth of DEPTH_32
+  DEPTH_8,     // uint8_t, only fit for very shallow scenes
+  DEPTH_FLOAT, // float, reversed-Z
+} DepthFormat;
 
-#ifdef ZBUFFER32
 typedef struct PingoDepth {
   uint32_t d;
 } PingoDepth;
-#endif
 
-#ifdef ZBUFFER16
-typedef struct Depth {
-  uint16_t d;
-} Depth;
-#endif
+// Bytes per pixel of a format
+extern int depth_format_size(DepthFormat format);
 
-#ifdef ZBUFFER8
-typedef struct Depth {
-  uint8_t d;
-} Depth;
-#endif
+static inline uint32_t depth_encode32(float value) { return (uint32_t)(value * (float)UINT32_MAX); }
+static inline uint16_t depth_encode16(float value) { return (uint16_t)(value * UINT16_MAX); }
+static inline uint8_t depth_encode8(float value) { return (uint8_t)(value * UINT8_MAX); }
 
+// DEPTH_32 write and test, true when the fragment is hidden
 void depth_write(PingoDepth *d, int idx, float value);
 bool depth_check(PingoDepth *d, int idx, float value);
+
+/**
+ * Coarse hierarchical depth: one PingoDepth per DEPTH_HIZ_TILE x
+ * DEPTH_HIZ_TILE block of the depth buffer holding the farthest depth stored
+ * in the block, in the format of the depth buffer. It only has to be
+ * conservative: depth writes only bring fragments closer, so a stale value is
+ * still a valid bound and the rasterizer refreshes it after drawing into a
+ * block.
+ */
+#define DEPTH_HIZ_TILE 8
+
+// Number of PingoDepth of the coarse buffer of a width x height depth buffer
+#define DEPTH_HIZ_SIZE(width, height)                                          \
+  ((((width) + DEPTH_HIZ_TILE - 1) / DEPTH_HIZ_TILE) *                         \
+   (((height) + DEPTH_HIZ_TILE - 1) / DEPTH_HIZ_TILE))
+
+// True when any fragment not nearer than value fails the depth test in the
+// block
+bool depth_hiz_reject(DepthFormat format, PingoDepth *hiz, int idx, float value);
+
+// Recomputes the farthest depth of the w x h pixels block starting at pixel
+// idx of the depth buffer d
+void depth_hiz_update(DepthFormat format, PingoDepth *hiz, int hizIdx,
+                      PingoDepth *d, int idx, int stride, int w, int h);
@@ -1,9 +1,57 @@
 #include "entity.h"
 #include "math/mat4.h"
 #include "render/array.h"
+#include "occlusion.h"
+#include "renderer.h"
 #include "state.h"
 #include <stddef.h>
 
+// Fills view_bounds over the visible subtree of the entity, drawn with
+// transform. Each sphere is transformed by the model view matrix its entity is
+// drawn with, as the view is applied before the model transforms (see
+// object_render), then merged in view space
+static Sphere entity_update_view_bounds(Entity *entity, Mat4 *transform, Renderer *renderer)
+{
+    Mat4 vm = mat4MultiplyM(&renderer->view, transform);
+    Sphere bounds = sphere_transform(entity->bounds, &vm);
+
+    Entity *children = entity->children_entities.data;
+    for (size_t i = 0; i < entity->children_entities.size; i++) {
+        if (!children[i].visible)
+            continue;
+        Mat4 child_transform = mat4MultiplyM(&children[i].transform, transform);
+        bounds = sphere_merge(bounds, entity_update_view_bounds(&children[i], &child_transform, renderer));
+    }
+
+    entity->view_bounds = bounds;
+    return bounds;
+}
+
+static int entity_draw(Entity *entity, Mat4 *transform, Renderer *renderer)
+{
+    if (frustum_cull_sphere(&renderer->frustum, entity->view_bounds))
+        return OK;
+
+    Occlusion *occlusion = renderer->occlusion;
+    if (occlusion != 0 && !occlusion->rasterizing) {
+        entity->occluded = occlusion_test_sphere(occlusion, renderer, entity->view_bounds);
+        if (entity->occluded)
+            return OK;
+    }
+
+    Entity *children = entity->children_entities.data;
+    for (size_t i = 0; i < entity->children_entities.size; i++) {
+        if (!children[i].visible)
+            continue;
+        Mat4 child_transform = mat4MultiplyM(&children[i].transform, transform);
+        entity_draw(&children[i], &child_transform, renderer);
+    }
+
+    Renderable *renderable = entity->entity_renderable;
+
+    return renderable->render(renderable, *transform, renderer);
+}
+
 int entity_render(void *this, Mat4 transform, Renderer *renderer)
 {
     Entity *entity = this;
@@ -15,16 +63,25 @@ int entity_render(void *this, Mat4 transform, Renderer *renderer)
 
     Mat4 new_transform = mat4MultiplyM(&entity->transform, &transform);
 
-    for (int i = 0; i < entity->children_entities.size; i++) {
-        Entity *child_entity = &entity->children_entities.data[i];
-        child_entity->renderable.render(child_entity, new_transform, renderer);
-    }
-
-    Renderable *renderable = entity->entity_renderable;
+    entity_update_view_bounds(entity, &new_transform, renderer);
 
-    return renderable->render(renderable, new_transform, renderer);
+    return entity_draw(entity, &new_transform, renderer);
 };
 
+// The bounds of an entity only nest in view space, a nested entity culls
+// itself when rendered
+static Sphere entity_bounds(void *this)
+{
+    (void)this;
+    return SPHERE_UNBOUNDED;
+}
+
+void entity_update_bounds(Entity *this)
+{
+    Renderable *renderable = this->entity_renderable;
+    this->bounds = renderable->bounds != 0 ? renderable->bounds(renderable) : SPHERE_UNBOUNDED;
+}
+
 int entity_init(Entity *this, Renderable *renderable, Mat4 transform)
 {
     IF_NULL_RETURN(this, INIT_ERROR);
@@ -32,10 +89,14 @@ int entity_init(Entity *this, Renderable *renderable, Mat4 transform)
 
     this->entity_renderable = renderable;
     this->renderable.render = &entity_render;
+    this->renderable.bounds = &entity_bounds;
     this->transform = transform;
     this->visible = true;
+    this->occluded = false;
+    this->view_bounds = SPHERE_UNBOUNDED;
 
     array_init(&this->children_entities, 0, 0);
+    entity_update_bounds(this);
 
     return OK;
 }
@@ -47,10 +108,14 @@ int entity_init_children(Entity *this, Renderable *renderable, Mat4 transform, E
 
     this->entity_renderable = renderable;
     this->renderable.render = &entity_render;
+    this->renderable.bounds = &entity_bounds;
     this->transform = transform;
     this->visible = true;
+    this->occluded = false;
+    this->view_bounds = SPHERE_UNBOUNDED;
 
     array_init(&this->children_entities, children_count, children);
+    entity_update_bounds(this);
 
     return OK;
 }
@@ -12,6 +12,19 @@ typedef struct {
   Mat4 transform;
   bool visible;
   Array children_entities;
+  // Bounds of the renderable, before transform is applied
+  Sphere bounds;
+  // Bounds of the renderable and of the visible children in view space, set
+  // when rendering. Entities outside the camera frustum are skipped with
+  // their whole subtree
+  Sphere view_bounds;
+  // Whether the last frame skipped the entity, with its subtree, as hidden
+  // behind occluders, see occlusion.h
+  bool occluded;
 } Entity;
 
 extern int entity_init(Entity *this, Renderable *renderable, Mat4 transform);
+
+/// Recomputes the bounds of the entity. Has to be called when the geometry of
+/// its renderable changed
+extern void entity_update_bounds(Entity *this);
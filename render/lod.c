@@ -0,0 +1,455 @@
+#include "lod.h"
+#include "clip.h"
+#include "math/fun.h"
+#include "math/mat4.h"
+#include "mesh.h"
+#include "object.h"
+#include "renderer.h"
+#include "state.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOD_NONE UINT16_MAX
+
+// Symmetric 4x4 matrix of a sum of squared plane distances, upper half
+typedef struct LodQuadric {
+    float q[10];
+} LodQuadric;
+
+// Collapse of the position from into the position to
+typedef struct LodCollapse {
+    float cost;
+    uint16_t from;
+    uint16_t to;
+} LodCollapse;
+
+typedef struct LodWork {
+    Mesh *source;
+    int positions;
+    int indexes; // Indices left in pos and tex
+
+    LodQuadric *quadrics;
+    uint32_t *offsets;   // First entry of each position in adjacency
+    uint32_t *adjacency; // Triangles around each position
+    LodCollapse *collapses;
+    uint16_t *pos;
+    uint16_t *tex;
+    uint16_t *remap;   // Position each position collapsed into
+    uint16_t *compact; // Index of a position in the level being written
+    uint8_t *border;
+    uint8_t *locked;
+} LodWork;
+
+static LodQuadric lod_quadric(Vec3f a, Vec3f b, Vec3f c)
+{
+    LodQuadric r = {{0}};
+    Vec3f n = vec3Cross(vec3fsubV(b, a), vec3fsubV(c, a));
+    if (vec3Dot(n, n) == 0)
+        return r;
+
+    n = vec3Normalize(n);
+    float d = -vec3Dot(n, a);
+    float p[4] = {n.x, n.y, n.z, d};
+    int k = 0;
+    for (int i = 0; i < 4; i++) {
+        for (int j = i; j < 4; j++)
+            r.q[k++] = p[i] * p[j];
+    }
+    return r;
+}
+
+static void lod_quadric_add(LodQuadric *a, const LodQuadric *b)
+{
+    for (int i = 0; i < 10; i++)
+        a->q[i] += b->q[i];
+}
+
+static float lod_quadric_error(const LodQuadric *a, const LodQuadric *b, Vec3f v)
+{
+    float q[10];
+    for (int i = 0; i < 10; i++)
+        q[i] = a->q[i] + b->q[i];
+
+    float e = q[0] * v.x * v.x + 2 * q[1] * v.x * v.y + 2 * q[2] * v.x * v.z + 2 * q[3] * v.x +
+              q[4] * v.y * v.y + 2 * q[5] * v.y * v.z + 2 * q[6] * v.y +
+              q[7] * v.z * v.z + 2 * q[8] * v.z + q[9];
+    return MAX(e, 0);
+}
+
+static int lod_compare(const void *a, const void *b)
+{
+    float ca = ((const LodCollapse *)a)->cost;
+    float cb = ((const LodCollapse *)b)->cost;
+    return (ca > cb) - (ca < cb);
+}
+
+// Triangles around each position, grouped with a counting sort
+static void lod_adjacency(LodWork *w)
+{
+    memset(w->offsets, 0, (w->positions + 1) * sizeof(uint32_t));
+    for (int i = 0; i < w->indexes; i++)
+        w->offsets[w->pos[i] + 1]++;
+    for (int p = 0; p < w->positions; p++)
+        w->offsets[p + 1] += w->offsets[p];
+
+    for (int i = 0; i < w->indexes; i++)
+        w->adjacency[w->offsets[w->pos[i]]++] = i / 3;
+
+    //Filling moved every offset to the start of the next position
+    for (int p = w->positions; p > 0; p--)
+        w->offsets[p] = w->offsets[p - 1];
+    w->offsets[0] = 0;
+}
+
+static int lod_corner(const LodWork *w, uint32_t triangle, uint16_t p)
+{
+    for (int k = 0; k < 3; k++) {
+        if (w->pos[triangle * 3 + k] == p)
+            return k;
+    }
+    return 0;
+}
+
+// Positions on a border, where an edge belongs to a single triangle, never
+// move so that holes keep their outline
+static void lod_borders(LodWork *w)
+{
+    for (int p = 0; p < w->positions; p++) {
+        w->border[p] = 0;
+        uint32_t first = w->offsets[p];
+        uint32_t last = w->offsets[p + 1];
+
+        for (uint32_t i = first; i < last && !w->border[p]; i++) {
+            uint32_t t = w->adjacency[i];
+            uint16_t next = w->pos[t * 3 + (lod_corner(w, t, p) + 1) % 3];
+
+            bool opposite = false;
+            for (uint32_t j = first; j < last && !opposite; j++) {
+                uint32_t u = w->adjacency[j];
+                opposite = w->pos[u * 3 + (lod_corner(w, u, p) + 2) % 3] == next;
+            }
+            w->border[p] = !opposite;
+        }
+    }
+}
+
+// Texture index for a corner of from using tex once moved to to: the one
+// of to in a collapsed triangle where from uses tex as well, so that the
+// corners on each side of a texture seam stay on their side
+static uint16_t lod_moved_tex(const LodWork *w, uint16_t from, uint16_t to, uint16_t tex)
+{
+    for (uint32_t i = w->offsets[from]; i < w->offsets[from + 1]; i++) {
+        uint32_t t = w->adjacency[i];
+        int corner = lod_corner(w, t, to);
+        if (w->pos[t * 3 + corner] == to && w->tex[t * 3 + lod_corner(w, t, from)] == tex)
+            return w->tex[t * 3 + corner];
+    }
+    return LOD_NONE;
+}
+
+// False when moving from onto to flips one of the triangles around from, or
+// tears a texture seam
+static bool lod_collapse_valid(const LodWork *w, uint16_t from, uint16_t to)
+{
+    const Vec3f *positions = w->source->positions;
+
+    for (uint32_t i = w->offsets[from]; i < w->offsets[from + 1]; i++) {
+        uint32_t triangle = w->adjacency[i];
+        const uint16_t *t = &w->pos[triangle * 3];
+        if (t[0] == to || t[1] == to || t[2] == to)
+            continue;
+
+        if (lod_moved_tex(w, from, to, w->tex[triangle * 3 + lod_corner(w, triangle, from)]) == LOD_NONE)
+            return false;
+
+        Vec3f v[3], moved[3];
+        for (int k = 0; k < 3; k++) {
+            v[k] = positions[t[k]];
+            moved[k] = t[k] == from ? positions[to] : v[k];
+        }
+        Vec3f before = vec3Cross(vec3fsubV(v[1], v[0]), vec3fsubV(v[2], v[0]));
+        Vec3f after = vec3Cross(vec3fsubV(moved[1], moved[0]), vec3fsubV(moved[2], moved[0]));
+        if (vec3Dot(before, after) <= 0)
+            return false;
+    }
+    return true;
+}
+
+// Collapses up to count edges, cheapest first. Returns the number of
+// collapses and raises error to the largest cost
+static int lod_pass(LodWork *w, int count, float *error)
+{
+    lod_adjacency(w);
+    lod_borders(w);
+
+    int candidates = 0;
+    for (int i = 0; i < w->indexes; i++) {
+        uint16_t from = w->pos[i];
+        uint16_t to = w->pos[i - i % 3 + (i + 1) % 3];
+        if (w->border[from])
+            continue;
+
+        LodCollapse *c = &w->collapses[candidates++];
+        c->from = from;
+        c->to = to;
+        c->cost = lod_quadric_error(&w->quadrics[from], &w->quadrics[to], w->source->positions[to]);
+    }
+    qsort(w->collapses, candidates, sizeof(LodCollapse), &lod_compare);
+
+    for (int p = 0; p < w->positions; p++) {
+        w->remap[p] = p;
+        w->locked[p] = 0;
+    }
+
+    //A collapse locks the positions around it, so that the adjacency and
+    //the flip test stay valid until the pass ends. Only the count cheapest
+    //candidates are tried, the ones skipped get another chance next pass
+    int collapsed = 0;
+    for (int c = 0; c < MIN(candidates, count); c++) {
+        uint16_t from = w->collapses[c].from;
+        uint16_t to = w->collapses[c].to;
+        if (w->locked[from] || w->locked[to] || !lod_collapse_valid(w, from, to))
+            continue;
+
+        //The collapsed triangles, which keep their texture indices until
+        //the end of the pass, tell the new ones of the others
+        for (uint32_t i = w->offsets[from]; i < w->offsets[from + 1]; i++) {
+            uint32_t t = w->adjacency[i];
+            if (w->pos[t * 3 + lod_corner(w, t, to)] == to)
+                continue;
+            uint16_t *tex = &w->tex[t * 3 + lod_corner(w, t, from)];
+            *tex = lod_moved_tex(w, from, to, *tex);
+        }
+
+        w->remap[from] = to;
+        lod_quadric_add(&w->quadrics[to], &w->quadrics[from]);
+        for (uint32_t i = w->offsets[from]; i < w->offsets[from + 1]; i++) {
+            const uint16_t *t = &w->pos[w->adjacency[i] * 3];
+            w->locked[t[0]] = w->locked[t[1]] = w->locked[t[2]] = 1;
+        }
+        *error = MAX(*error, w->collapses[c].cost);
+        collapsed++;
+    }
+
+    //Move the corners and drop the triangles that became degenerate
+    int indexes = 0;
+    for (int i = 0; i < w->indexes; i += 3) {
+        uint16_t p[3];
+        for (int k = 0; k < 3; k++)
+            p[k] = w->remap[w->pos[i + k]];
+        if (p[0] == p[1] || p[1] == p[2] || p[2] == p[0])
+            continue;
+
+        for (int k = 0; k < 3; k++) {
+            w->pos[indexes + k] = p[k];
+            w->tex[indexes + k] = w->tex[i + k];
+        }
+        indexes += 3;
+    }
+    w->indexes = indexes;
+
+    return collapsed;
+}
+
+// Writes the current triangles as a mesh, with its positions compacted.
+// False when the storage left is too small
+static bool lod_write(LodWork *w, Mesh *level, uint16_t **indices, uint16_t *indicesEnd,
+                      Vec3f **positions, Vec3f *positionsEnd)
+{
+    int used = 0;
+    for (int p = 0; p < w->positions; p++)
+        w->compact[p] = LOD_NONE;
+    for (int i = 0; i < w->indexes; i++) {
+        if (w->compact[w->pos[i]] == LOD_NONE)
+            w->compact[w->pos[i]] = used++;
+    }
+
+    bool textured = w->source->tex_indices != 0;
+    if (*indices + w->indexes * (textured ? 2 : 1) > indicesEnd || *positions + used > positionsEnd)
+        return false;
+
+    *level = *w->source;
+    level->indexes_count = w->indexes;
+    level->positions_count = used;
+    level->meshlets = 0;
+    level->meshlets_count = 0;
+
+    level->positions = *positions;
+    for (int p = 0; p < w->positions; p++) {
+        if (w->compact[p] != LOD_NONE)
+            level->positions[w->compact[p]] = w->source->positions[p];
+    }
+    *positions += used;
+
+    level->pos_indices = *indices;
+    for (int i = 0; i < w->indexes; i++)
+        level->pos_indices[i] = w->compact[w->pos[i]];
+    *indices += w->indexes;
+
+    if (textured) {
+        level->tex_indices = *indices;
+        memcpy(level->tex_indices, w->tex, w->indexes * sizeof(uint16_t));
+        *indices += w->indexes;
+    }
+
+    return true;
+}
+
+int mesh_build_lods(Mesh *source, Mesh *levels, float *errors, int count,
+                    uint16_t *indices, Vec3f *positions, void *scratch)
+{
+    IF_NULL_RETURN(source, INIT_ERROR);
+    IF_NULL_RETURN(levels, INIT_ERROR);
+    IF_NULL_RETURN(errors, INIT_ERROR);
+    IF_NULL_RETURN(indices, INIT_ERROR);
+    IF_NULL_RETURN(positions, INIT_ERROR);
+    IF_NULL_RETURN(scratch, INIT_ERROR);
+
+    if (count < 1 || count > LOD_LEVELS_MAX || source->indexes_count < 3)
+        return INIT_ERROR;
+
+    LodWork w;
+    w.source = source;
+    w.positions = mesh_positions_count(source);
+    w.indexes = source->indexes_count;
+    mesh_bounds(source);
+
+    //Carve the scratch memory, largest alignment first
+    uint8_t *s = scratch;
+    w.quadrics = (LodQuadric *)s;
+    s += w.positions * sizeof(LodQuadric);
+    w.offsets = (uint32_t *)s;
+    s += (w.positions + 1) * sizeof(uint32_t);
+    w.adjacency = (uint32_t *)s;
+    s += w.indexes * sizeof(uint32_t);
+    w.collapses = (LodCollapse *)s;
+    s += w.indexes * sizeof(LodCollapse);
+    w.pos = (uint16_t *)s;
+    s += w.indexes * sizeof(uint16_t);
+    w.tex = (uint16_t *)s;
+    s += w.indexes * sizeof(uint16_t);
+    w.remap = (uint16_t *)s;
+    s += w.positions * sizeof(uint16_t);
+    w.compact = (uint16_t *)s;
+    s += w.positions * sizeof(uint16_t);
+    w.border = s;
+    s += w.positions;
+    w.locked = s;
+
+    memcpy(w.pos, source->pos_indices, w.indexes * sizeof(uint16_t));
+    if (source->tex_indices != 0)
+        memcpy(w.tex, source->tex_indices, w.indexes * sizeof(uint16_t));
+    else
+        memset(w.tex, 0, w.indexes * sizeof(uint16_t));
+
+    memset(w.quadrics, 0, w.positions * sizeof(LodQuadric));
+    for (int i = 0; i < w.indexes; i += 3) {
+        const uint16_t *t = &w.pos[i];
+        LodQuadric q = lod_quadric(source->positions[t[0]], source->positions[t[1]], source->positions[t[2]]);
+        for (int k = 0; k < 3; k++)
+            lod_quadric_add(&w.quadrics[t[k]], &q);
+    }
+
+    levels[0] = *source;
+    errors[0] = 0;
+
+    uint16_t *indicesEnd = indices + MESH_LODS_INDICES(source->indexes_count);
+    Vec3f *positionsEnd = positions + MESH_LODS_POSITIONS(w.positions);
+    float error = 0;
+    int level = 1;
+
+    for (; level < count; level++) {
+        int target = (source->indexes_count / 3) >> level;
+        //Stops when no collapse is left, the next level then stays empty
+        int before = w.indexes;
+        bool progress = true;
+        while (w.indexes / 3 > target && progress) {
+            //A collapse removes two triangles on a closed surface
+            progress = lod_pass(&w, (w.indexes / 3 - target + 1) / 2, &error) > 0;
+        }
+
+        if (w.indexes == before || !lod_write(&w, &levels[level], &indices, indicesEnd, &positions, positionsEnd))
+            break;
+        errors[level] = sqrtf(error);
+    }
+
+    //Nothing left to simplify, the last level is repeated
+    for (; level < count; level++) {
+        levels[level] = levels[level - 1];
+        errors[level] = errors[level - 1];
+    }
+
+    return OK;
+}
+
+static Sphere lod_bounds(void *this)
+{
+    Lod *lod = this;
+    Renderable *finest = &lod->levels[0].renderable;
+    return finest->bounds(finest);
+}
+
+// Coarsest level whose error stays under the threshold at the distance of
+// the bounds, starting from the level of the last frame
+static int lod_select(Lod *this, Mat4 *transform, Renderer *r)
+{
+    Sphere bounds = lod_bounds(this);
+    if (bounds.radius <= 0)
+        return 0;
+
+    Mat4 vm = mat4MultiplyM(&r->view, transform);
+    Sphere s = sphere_transform(bounds, &vm);
+    float distance = -s.center.z - s.radius;
+    if (distance < CLIP_W_MIN)
+        return 0;
+
+    //Screen pixels per view space unit at the nearest point of the bounds.
+    //The threshold is pixel_error pixels in mesh units, the view space
+    //sphere radius over the mesh one being the scale of the transform
+    float pixels = r->camera_projection.elements[5] * r->framebuffer.size.y * 0.5f / distance;
+    float threshold = this->pixel_error * bounds.radius / (s.radius * pixels);
+
+    int level = MIN(this->level, this->levels_count - 1);
+    while (level + 1 < this->levels_count && this->errors[level + 1] <= threshold * LOD_HYSTERESIS)
+        level++;
+    while (level > 0 && this->errors[level] > threshold)
+        level--;
+    return level;
+}
+
+static int lod_render(void *this, Mat4 transform, Renderer *r)
+{
+    Lod *lod = this;
+    IF_NULL_RETURN(lod, RENDER_ERROR);
+    IF_NULL_RETURN(r, RENDER_ERROR);
+
+    lod->level = lod_select(lod, &transform, r);
+
+    Renderable *renderable = &lod->levels[lod->level].renderable;
+    return renderable->render(renderable, transform, r);
+}
+
+int lod_init(Lod *this, Object *levels, const float *errors, int count, float pixel_error)
+{
+    IF_NULL_RETURN(this, INIT_ERROR);
+    IF_NULL_RETURN(levels, INIT_ERROR);
+    IF_NULL_RETURN(errors, INIT_ERROR);
+
+    if (count < 1 || count > LOD_LEVELS_MAX)
+        return INIT_ERROR;
+
+    this->levels = levels;
+    this->levels_count = count;
+    for (int i = 0; i < count; i++)
+        this->errors[i] = errors[i];
+    this->level = 0;
+    this->pixel_error = pixel_error;
+
+    this->renderable.render = &lod_render;
+    this->renderable.bounds = &lod_bounds;
+
+    return OK;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "math/vec3.h"
+#include "renderable.h"
+
+typedef struct Mesh Mesh;
+typedef struct Object Object;
+
+/**
+ * Levels of detail.
+ *
+ * mesh_build_lods is meant to run once at load time. It simplifies a mesh by
+ * quadric edge collapse: edges are collapsed into one of their ends, cheapest
+ * first, where the cost of moving a vertex is its squared distance to the
+ * planes of the faces merged into it. Each level keeps about half of the
+ * triangles of the previous one, and records the largest distance a vertex
+ * moved so far: its error in mesh units.
+ *
+ * Lod is a renderable drawing one of the levels. Each frame it picks the
+ * coarsest level whose error, projected at the distance of the bounds, stays
+ * under pixel_error pixels. A coarser level is only taken once its error
+ * falls LOD_HYSTERESIS below the threshold, so that a model at the limit
+ * distance does not flip between two levels.
+ */
+
+#define LOD_LEVELS_MAX 8
+
+// A coarser level is taken when its error is below this fraction of the
+// threshold
+#define LOD_HYSTERESIS 0.75f
+
+// Indices needed by mesh_build_lods for the levels of a mesh, position and
+// texture indices together
+#define MESH_LODS_INDICES(indexes_count) ((indexes_count) * 4)
+
+// Positions needed by mesh_build_lods for the levels of a mesh
+#define MESH_LODS_POSITIONS(positions_count) ((positions_count) * 2)
+
+// Bytes of scratch memory needed by mesh_build_lods
+#define MESH_LODS_SCRATCH_SIZE(positions_count, indexes_count)                   \
+  ((positions_count) * 50 + (indexes_count) * 16 + 4)
+
+typedef struct Lod {
+  Renderable renderable;
+  Object *levels; // Finest first
+  float errors[LOD_LEVELS_MAX]; // Error of each level in mesh units
+  int levels_count;
+  int level; // Level drawn by the last frame
+  float pixel_error;
+} Lod;
+
+/// Fills levels[0 .. count - 1] with simplifications of source, levels[0]
+/// being source itself. The levels share the texture coordinates of source,
+/// their indices and positions are stored in indices and positions, which
+/// must hold MESH_LODS_INDICES and MESH_LODS_POSITIONS elements. scratch
+/// must hold MESH_LODS_SCRATCH_SIZE bytes, aligned for a float
+extern int mesh_build_lods(Mesh *source, Mesh *levels, float *errors, int count,
+                           uint16_t *indices, Vec3f *positions, void *scratch);
+
+/// levels are objects drawing the meshes built by mesh_build_lods, finest
+/// first
+extern int lod_init(Lod *this, Object *levels, const float *errors, int count, float pixel_error);
@@ -7,5 +7,19 @@ int material_init(Material *this, Texture *texture)
     IF_NULL_RETURN(texture, INIT_ERROR);
 
     this->texture = texture;
-    return OK;
+    return sampler_init(&this->sampler, texture, SAMPLER_REPEAT, SAMPLER_NEAREST);
+}
+
+int material_set_wrap(Material *this, SamplerWrap wrap)
+{
+    IF_NULL_RETURN(this, SET_ERROR);
+
+    return sampler_init(&this->sampler, this->texture, wrap, this->sampler.filter);
+}
+
+int material_set_filter(Material *this, SamplerFilter filter)
+{
+    IF_NULL_RETURN(this, SET_ERROR);
+
+    return sampler_init(&this->sampler, this->texture, this->sampler.wrap, filter);
 }
@@ -1,9 +1,16 @@
 #pragma once
 
+#include "sampler.h"
 #include "texture.h"
 
 typedef struct Material {
   Texture *texture;
+  Sampler sampler; // Fetches texels of texture, nearest and repeating by default
 } Material;
 
 int material_init(Material *this, Texture *texture);
+
+int material_set_wrap(Material *this, SamplerWrap wrap);
+
+// Filter of textures without mipmaps, mipmapped ones use their own
+int material_set_filter(Material *this, SamplerFilter filter);
@@ -1,10 +1,45 @@
 #include "mesh.h"
-
-
-
-
-
-
-
-
-
+#include "math/fun.h"
+
+#include <math.h>
+
+int mesh_positions_count(Mesh *mesh)
+{
+    if (mesh->positions_count == 0) {
+        for (int i = 0; i < mesh->indexes_count; i++) {
+            if (mesh->pos_indices[i] >= mesh->positions_count)
+                mesh->positions_count = mesh->pos_indices[i] + 1;
+        }
+    }
+    return mesh->positions_count;
+}
+
+Sphere mesh_bounds(Mesh *mesh)
+{
+    if (mesh->sphere.radius > 0)
+        return mesh->sphere;
+
+    int count = mesh_positions_count(mesh);
+    if (count == 0)
+        return SPHERE_UNBOUNDED;
+
+    Vec3f lo = mesh->positions[0];
+    Vec3f hi = lo;
+    for (int i = 1; i < count; i++) {
+        Vec3f p = mesh->positions[i];
+        lo = (Vec3f){MIN(lo.x, p.x), MIN(lo.y, p.y), MIN(lo.z, p.z)};
+        hi = (Vec3f){MAX(hi.x, p.x), MAX(hi.y, p.y), MAX(hi.z, p.z)};
+    }
+
+    Vec3f center = vec3fmul(vec3fsumV(lo, hi), 0.5f);
+    float radius = 0;
+    for (int i = 0; i < count; i++) {
+        Vec3f d = vec3fsubV(mesh->positions[i], center);
+        radius = MAX(radius, vec3Dot(d, d));
+    }
+
+    mesh->aabb_min = lo;
+    mesh->aabb_max = hi;
+    mesh->sphere = (Sphere){center, sqrtf(radius)};
+    return mesh->sphere;
+}
@@ -4,13 +4,29 @@
 
 #include "math/vec2.h"
 #include "math/vec3.h"
+#include "bounds.h"
+#include "meshlet.h"
 
 typedef struct Mesh {
     int indexes_count;
+    int positions_count; // Can be left 0, it is then computed from pos_indices
     uint16_t * pos_indices;
     uint16_t * tex_indices;
     Vec3f * positions;
     Vec2f * textCoord;
+
+    // Bounds of the positions, computed by mesh_bounds when left 0
+    Vec3f aabb_min;
+    Vec3f aabb_max;
+    Sphere sphere;
+
+    // Optional clusters of triangles, see meshlet.h
+    Meshlet * meshlets;
+    int meshlets_count;
 } Mesh;
 
+// Number of positions referenced by the mesh indices
+extern int mesh_positions_count(Mesh *mesh);
 
+// Bounding sphere of the positions, centered on their bounding box
+extern Sphere mesh_bounds(Mesh *mesh);
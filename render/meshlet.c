@@ -0,0 +1,219 @@
+#include "meshlet.h"
+#include "math/fun.h"
+#include "mesh.h"
+#include "state.h"
+
+#include <math.h>
+
+// Widens the normal cones so that rounding never culls a triangle seen
+// almost edge on
+#define MESHLET_CONE_SLACK 1e-3f
+
+// Face normal, not normalized, in the orientation used for lighting
+static Vec3f meshlet_normal(const Mesh *mesh, int i)
+{
+    Vec3f a = mesh->positions[mesh->pos_indices[i + 0]];
+    Vec3f b = mesh->positions[mesh->pos_indices[i + 1]];
+    Vec3f c = mesh->positions[mesh->pos_indices[i + 2]];
+    return vec3Cross(vec3fsubV(b, a), vec3fsubV(c, a));
+}
+
+static Vec3f meshlet_centroid(const Mesh *mesh, int i)
+{
+    Vec3f a = mesh->positions[mesh->pos_indices[i + 0]];
+    Vec3f b = mesh->positions[mesh->pos_indices[i + 1]];
+    Vec3f c = mesh->positions[mesh->pos_indices[i + 2]];
+    return vec3fmul(vec3fsumV(vec3fsumV(a, b), c), 1.0f / 3);
+}
+
+// Nearest of the MESHLET_DIRECTIONS directions
+static uint32_t meshlet_direction(Vec3f n)
+{
+    uint32_t best = 0;
+    float bestDot = -INFINITY;
+    uint32_t direction = 0;
+
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            for (int z = -1; z <= 1; z++) {
+                if (x == 0 && y == 0 && z == 0)
+                    continue;
+                float d = (n.x * x + n.y * y + n.z * z) / sqrtf(x * x + y * y + z * z);
+                if (d > bestDot) {
+                    bestDot = d;
+                    best = direction;
+                }
+                direction++;
+            }
+        }
+    }
+    return best;
+}
+
+// Interleaves the bits of three 8 bit coordinates
+static uint32_t meshlet_morton(uint32_t x, uint32_t y, uint32_t z)
+{
+    uint32_t code = 0;
+    for (int bit = 0; bit < 8; bit++) {
+        code |= ((x >> bit) & 1) << (bit * 3 + 0);
+        code |= ((y >> bit) & 1) << (bit * 3 + 1);
+        code |= ((z >> bit) & 1) << (bit * 3 + 2);
+    }
+    return code;
+}
+
+// Sort key of a triangle: its direction, then its position along a Morton
+// curve over the mesh bounds
+static uint32_t meshlet_key(const Mesh *mesh, int i, Vec3f lo, Vec3f scale)
+{
+    Vec3f c = meshlet_centroid(mesh, i);
+    uint32_t x = MIN(MAX((c.x - lo.x) * scale.x, 0), 255);
+    uint32_t y = MIN(MAX((c.y - lo.y) * scale.y, 0), 255);
+    uint32_t z = MIN(MAX((c.z - lo.z) * scale.z, 0), 255);
+    return meshlet_direction(meshlet_normal(mesh, i)) << 24 | meshlet_morton(x, y, z);
+}
+
+// Shell sort of the triangles by key, moving their indices along
+static void meshlet_sort(Mesh *mesh, uint32_t *keys, int triangles)
+{
+    static const int gaps[] = {701, 301, 132, 57, 23, 10, 4, 1};
+
+    for (int g = 0; g < (int)(sizeof(gaps) / sizeof(gaps[0])); g++) {
+        int gap = gaps[g];
+        for (int i = gap; i < triangles; i++) {
+            uint32_t key = keys[i];
+            uint16_t pos[3], tex[3];
+            for (int k = 0; k < 3; k++) {
+                pos[k] = mesh->pos_indices[i * 3 + k];
+                if (mesh->tex_indices != 0)
+                    tex[k] = mesh->tex_indices[i * 3 + k];
+            }
+
+            int j = i;
+            for (; j >= gap && keys[j - gap] > key; j -= gap) {
+                keys[j] = keys[j - gap];
+                for (int k = 0; k < 3; k++) {
+                    mesh->pos_indices[j * 3 + k] = mesh->pos_indices[(j - gap) * 3 + k];
+                    if (mesh->tex_indices != 0)
+                        mesh->tex_indices[j * 3 + k] = mesh->tex_indices[(j - gap) * 3 + k];
+                }
+            }
+
+            keys[j] = key;
+            for (int k = 0; k < 3; k++) {
+                mesh->pos_indices[j * 3 + k] = pos[k];
+                if (mesh->tex_indices != 0)
+                    mesh->tex_indices[j * 3 + k] = tex[k];
+            }
+        }
+    }
+}
+
+// Bounding sphere and normal cone of the triangles of a meshlet
+static void meshlet_bounds(const Mesh *mesh, Meshlet *meshlet)
+{
+    int last = meshlet->first + meshlet->count;
+
+    Vec3f lo = mesh->positions[mesh->pos_indices[meshlet->first]];
+    Vec3f hi = lo;
+    Vec3f axis = {0, 0, 0};
+    for (int i = meshlet->first; i < last; i++) {
+        Vec3f p = mesh->positions[mesh->pos_indices[i]];
+        lo = (Vec3f){MIN(lo.x, p.x), MIN(lo.y, p.y), MIN(lo.z, p.z)};
+        hi = (Vec3f){MAX(hi.x, p.x), MAX(hi.y, p.y), MAX(hi.z, p.z)};
+        if ((i - meshlet->first) % 3 == 0) {
+            Vec3f n = meshlet_normal(mesh, i);
+            if (vec3Dot(n, n) > 0)
+                axis = vec3fsumV(axis, vec3Normalize(n));
+        }
+    }
+
+    Vec3f center = vec3fmul(vec3fsumV(lo, hi), 0.5f);
+    float radius = 0;
+    for (int i = meshlet->first; i < last; i++) {
+        Vec3f d = vec3fsubV(mesh->positions[mesh->pos_indices[i]], center);
+        radius = MAX(radius, vec3Dot(d, d));
+    }
+    meshlet->bounds = (Sphere){center, sqrtf(radius)};
+
+    meshlet->cone_cutoff = 2;
+    meshlet->cone_apex = center;
+    meshlet->cone_axis = (Vec3f){0, 0, 1};
+    if (vec3Dot(axis, axis) == 0)
+        return;
+    axis = vec3Normalize(axis);
+    meshlet->cone_axis = axis;
+
+    //Smallest cosine between the axis and a face normal
+    float minDot = 1;
+    for (int i = meshlet->first; i < last; i += 3) {
+        Vec3f n = meshlet_normal(mesh, i);
+        if (vec3Dot(n, n) > 0)
+            minDot = MIN(minDot, vec3Dot(axis, vec3Normalize(n)));
+    }
+    minDot -= MESHLET_CONE_SLACK;
+    if (minDot <= 0)
+        return;
+
+    //Move the apex back along the axis until it is behind every face plane
+    float distance = 0;
+    for (int i = meshlet->first; i < last; i += 3) {
+        Vec3f n = meshlet_normal(mesh, i);
+        if (vec3Dot(n, n) == 0)
+            continue;
+        n = vec3Normalize(n);
+        Vec3f p = mesh->positions[mesh->pos_indices[i]];
+        distance = MAX(distance, vec3Dot(vec3fsubV(center, p), n) / vec3Dot(axis, n));
+    }
+
+    meshlet->cone_apex = vec3fsubV(center, vec3fmul(axis, distance));
+    meshlet->cone_cutoff = sqrtf(1 - minDot * minDot);
+}
+
+int mesh_build_meshlets(Mesh *mesh, Meshlet *meshlets, int capacity, uint32_t *scratch)
+{
+    IF_NULL_RETURN(mesh, INIT_ERROR);
+    IF_NULL_RETURN(meshlets, INIT_ERROR);
+    IF_NULL_RETURN(scratch, INIT_ERROR);
+
+    int triangles = mesh->indexes_count / 3;
+    if (triangles == 0 || capacity < MESHLETS_COUNT_MAX(mesh->indexes_count))
+        return INIT_ERROR;
+
+    mesh_bounds(mesh);
+    Vec3f size = vec3fsubV(mesh->aabb_max, mesh->aabb_min);
+    Vec3f scale = {size.x > 0 ? 255 / size.x : 0,
+                   size.y > 0 ? 255 / size.y : 0,
+                   size.z > 0 ? 255 / size.z : 0};
+
+    for (int t = 0; t < triangles; t++)
+        scratch[t] = meshlet_key(mesh, t * 3, mesh->aabb_min, scale);
+
+    meshlet_sort(mesh, scratch, triangles);
+
+    //Cut a new meshlet when the direction changes or the current one is full
+    int count = 0;
+    for (int t = 0; t < triangles; t++) {
+        Meshlet *current = count > 0 ? &meshlets[count - 1] : 0;
+        if (current == 0 || current->count == MESHLET_TRIANGLES * 3 ||
+            (scratch[t] >> 24) != (scratch[t - 1] >> 24)) {
+            current = &meshlets[count++];
+            current->first = t * 3;
+            current->count = 0;
+        }
+        current->count += 3;
+    }
+
+    for (int m = 0; m < count; m++)
+        meshlet_bounds(mesh, &meshlets[m]);
+
+    mesh->meshlets = meshlets;
+    mesh->meshlets_count = count;
+    return OK;
+}
+
+bool meshlet_backfacing(const Meshlet *meshlet, Vec3f eye)
+{
+    Vec3f v = vec3fsubV(meshlet->cone_apex, eye);
+    return vec3Dot(v, meshlet->cone_axis) >= meshlet->cone_cutoff * sqrtf(vec3Dot(v, v));
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "bounds.h"
+#include "math/vec3.h"
+
+typedef struct Mesh Mesh;
+
+/**
+ * Meshlets: small clusters of triangles that can be culled as a whole.
+ *
+ * mesh_build_meshlets is meant to run once at load time. It reorders the
+ * triangles of a mesh so that each cluster is a contiguous range of indices,
+ * grouping triangles that face roughly the same direction and lie close to
+ * each other. Each meshlet stores a bounding sphere for frustum culling and a
+ * normal cone: when the camera lies on the back side of every triangle of
+ * the cluster, object_render skips it before transforming any of its
+ * vertices.
+ */
+
+// Largest number of triangles in a meshlet
+#define MESHLET_TRIANGLES 64
+
+// Triangles are grouped by the nearest of the 26 directions of a 3x3x3 grid
+#define MESHLET_DIRECTIONS 26
+
+// Meshlets needed at most for a mesh with the given number of indices
+#define MESHLETS_COUNT_MAX(indexes_count)                                       \
+  ((indexes_count) / 3 / MESHLET_TRIANGLES + MESHLET_DIRECTIONS)
+
+typedef struct Meshlet {
+  int first; // First index in the mesh indices
+  int count; // Number of indices
+  Sphere bounds;
+  Vec3f cone_apex;
+  Vec3f cone_axis;
+  float cone_cutoff; // Sine of the cone half angle, above 1 when it cannot cull
+} Meshlet;
+
+/// Reorders the triangles of the mesh and splits them into meshlets, which
+/// are stored in the mesh. meshlets must hold MESHLETS_COUNT_MAX elements
+/// and scratch one element per triangle
+extern int mesh_build_meshlets(Mesh *mesh, Meshlet *meshlets, int capacity, uint32_t *scratch);
+
+/// True when the camera, at eye in the mesh space, sees the back of every
+/// triangle of the meshlet
+extern bool meshlet_backfacing(const Meshlet *meshlet, Vec3f eye);
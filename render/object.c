@@ -1,175 +1,350 @@
 #include "object.h"
-#include "backend.h"
-#include "depth.h"
+#include "clip.h"
 #include "math/fun.h"
 #include "math/mat4.h"
 #include "mesh.h"
+#include "occlusion.h"
+#include "queue.h"
 #include "render/material.h"
 #include "renderer.h"
 #include "state.h"
+#include "triangle.h"
+#include "vertex.h"
+
+// Screen space setup of a culled triangle, given its device coordinates
+// with 1 / w in the last component
+static void object_draw_triangle(Renderer *r, Material *material, float light,
+                                 Vec4f a, Vec4f b, Vec4f c,
+                                 Vec2f tca, Vec2f tcb, Vec2f tcc)
+{
+    const Vec2i scrSize = r->framebuffer.size;
 
-int object_render(void *this, Mat4 m, Renderer *r)
+    //Compute Screen coordinates
+    float halfX = scrSize.x / 2;
+    float halfY = scrSize.y / 2;
+    Triangle t;
+    t.a = (Vec2i){a.x * halfX + halfX, a.y * halfY + halfY};
+    t.b = (Vec2i){b.x * halfX + halfX, b.y * halfY + halfY};
+    t.c = (Vec2i){c.x * halfX + halfX, c.y * halfY + halfY};
+
+    int32_t minX = MIN(MIN(t.a.x, t.b.x), t.c.x);
+    int32_t minY = MIN(MIN(t.a.y, t.b.y), t.c.y);
+    int32_t maxX = MAX(MAX(t.a.x, t.b.x), t.c.x);
+    int32_t maxY = MAX(MAX(t.a.y, t.b.y), t.c.y);
+
+    t.bounds.x = MIN(MAX(minX, 0), scrSize.x);
+    t.bounds.y = MIN(MAX(minY, 0), scrSize.y);
+    t.bounds.z = MIN(MAX(maxX, 0), scrSize.x);
+    t.bounds.w = MIN(MAX(maxY, 0), scrSize.y);
+
+    //Triangle is completely off screen
+    if (t.bounds.x >= t.bounds.z || t.bounds.y >= t.bounds.w)
+        return;
+
+    t.area = orient2d(t.a, t.b, t.c);
+    if (t.area == 0)
+        return;
+    t.areaInverse = 1.0 / t.area;
+
+    //Texture coordinates are linear in screen space once divided by w
+    if (material != 0) {
+        tca.x *= a.w;
+        tca.y *= a.w;
+        tcb.x *= b.w;
+        tcb.y *= b.w;
+        tcc.x *= c.w;
+        tcc.y *= c.w;
+    }
+
+    t.za = a.z;
+    t.zb = b.z;
+    t.zc = c.z;
+    t.wa = a.w;
+    t.wb = b.w;
+    t.wc = c.w;
+    t.tca = tca;
+    t.tcb = tcb;
+    t.tcc = tcc;
+    t.light = (uint32_t)(light * 256 + 0.5f); // Shaded with integers, see pixelShade
+    t.material = material;
+
+    renderer_draw_triangle(r, &t);
+}
+
+// Clips a triangle crossing the near plane or the guard band and draws the
+// resulting polygon as a fan
+static void object_draw_clipped(Renderer *r, Material *material, float light,
+                                const Vertex *va, const Vertex *vb, const Vertex *vc,
+                                Vec2f tca, Vec2f tcb, Vec2f tcc, Vec2f guard)
 {
-    Object *o = this;
+    ClipVertex poly[CLIP_MAX_VERTICES] = {
+        {va->clip, tca},
+        {vb->clip, tcb},
+        {vc->clip, tcc},
+    };
+
+    int count = clip_polygon(poly, 3, guard);
+
+    Vec4f ndc[CLIP_MAX_VERTICES];
+    for (int i = 0; i < count; i++) {
+        Vec4f *p = &poly[i].clip;
+        ndc[i] = (Vec4f){p->x / p->w, p->y / p->w, p->z / p->w, 1.0f / p->w};
+    }
 
-    IF_NULL_RETURN(o, RENDER_ERROR);
-    IF_NULL_RETURN(r, RENDER_ERROR);
+    for (int i = 1; i + 1 < count; i++) {
+        Vec4f *a = &ndc[0];
+        Vec4f *b = &ndc[i];
+        Vec4f *c = &ndc[i + 1];
+        if (isClockWise(a->x, a->y, b->x, b->y, c->x, c->y) >= 0)
+            continue;
+        object_draw_triangle(r, material, light, *a, *b, *c,
+                             poly[0].uv, poly[i].uv, poly[i + 1].uv);
+    }
+}
 
-    const Vec2i scrSize = r->framebuffer.size;
+// Number of depth buckets faces are sorted into, see renderer_set_face_sort.
+// The last uint8_t value marks culled faces
+#define OBJECT_FACE_BUCKETS 255
+#define OBJECT_FACE_CULLED UINT8_MAX
 
-    // VIEW MATRIX
-    Mat4 v = mat4Inverse( &r->camera_view );
-    Mat4 p = r->camera_projection;
-
-    for (int i = 0; i < o->mesh->indexes_count; i += 3) {
-        Vec3f *ver1 = &o->mesh->positions[o->mesh->pos_indices[i + 0]];
-        Vec3f *ver2 = &o->mesh->positions[o->mesh->pos_indices[i + 1]];
-        Vec3f *ver3 = &o->mesh->positions[o->mesh->pos_indices[i + 2]];
-
-        Vec2f tca = {0, 0};
-        Vec2f tcb = {0, 0};
-        Vec2f tcc = {0, 0};
-
-        if (o->material != 0) {
-            tca = o->mesh->textCoord[o->mesh->tex_indices[i + 0]];
-            tcb = o->mesh->textCoord[o->mesh->tex_indices[i + 1]];
-            tcc = o->mesh->textCoord[o->mesh->tex_indices[i + 2]];
-        }
+// True when the face is not trivially outside the frustum nor back facing
+static inline bool object_face_visible(const Vertex *va, const Vertex *vb, const Vertex *vc)
+{
+    //Triangle is completely outside one of the frustum planes
+    if (va->clip_flags & vb->clip_flags & vc->clip_flags & CLIP_FRUSTUM)
+        return false;
 
-        Vec4f a = {ver1->x, ver1->y, ver1->z, 1};
-        Vec4f b = {ver2->x, ver2->y, ver2->z, 1};
-        Vec4f c = {ver3->x, ver3->y, ver3->z, 1};
+    //Backface culling, clipped triangles are culled after clipping
+    if ((va->clip_flags | vb->clip_flags | vc->clip_flags) & CLIP_NEEDED)
+        return true;
 
-        Mat4 vm = mat4MultiplyM(&v,&m);
+    return isClockWise(va->ndc.x, va->ndc.y,
+                       vb->ndc.x, vb->ndc.y,
+                       vc->ndc.x, vc->ndc.y) < 0;
+}
 
-        a = mat4MultiplyVec4(&a, &vm);
-        b = mat4MultiplyVec4(&b, &vm);
-        c = mat4MultiplyVec4(&c, &vm);
+// Lighting, clipping and setup of the visible face starting at index i
+static void object_draw_face(Renderer *r, Object *o, int i,
+                             const Vertex *va, const Vertex *vb, const Vertex *vc,
+                             Vec2f guard)
+{
+    Mesh *mesh = o->mesh;
+    bool clipped = (va->clip_flags | vb->clip_flags | vc->clip_flags) & CLIP_NEEDED;
 
-        //Calc Face Normal
-        Vec3f na = vec3fsubV(*((Vec3f *) (&a)), *((Vec3f *) (&b)));
-        Vec3f nb = vec3fsubV(*((Vec3f *) (&a)), *((Vec3f *) (&c)));
-        Vec3f normal = vec3Normalize(vec3Cross(na, nb));
-        Vec3f light = vec3Normalize((Vec3f){-8, 5, 5});
-        float diffuseLight = (1.0 + vec3Dot(normal, light)) * 0.5;
-        diffuseLight = MIN(1.0, MAX(diffuseLight, 0));
+    Vec2f tca = {0, 0};
+    Vec2f tcb = {0, 0};
+    Vec2f tcc = {0, 0};
 
-        a = mat4MultiplyVec4(&a, &p);
-        b = mat4MultiplyVec4(&b, &p);
-        c = mat4MultiplyVec4(&c, &p);
+    if (o->material != 0) {
+        tca = mesh->textCoord[mesh->tex_indices[i + 0]];
+        tcb = mesh->textCoord[mesh->tex_indices[i + 1]];
+        tcc = mesh->textCoord[mesh->tex_indices[i + 2]];
+    }
 
+    //Calc Face Normal
+    Vec3f na = vec3fsubV(va->view, vb->view);
+    Vec3f nb = vec3fsubV(va->view, vc->view);
+    Vec3f normal = vec3Normalize(vec3Cross(na, nb));
+    Vec3f light = vec3Normalize((Vec3f){-8, 5, 5});
+    float diffuseLight = (1.0 + vec3Dot(normal, light)) * 0.5;
+    diffuseLight = MIN(1.0, MAX(diffuseLight, 0));
+
+    if (clipped)
+        object_draw_clipped(r, o->material, diffuseLight, va, vb, vc, tca, tcb, tcc, guard);
+    else
+        object_draw_triangle(r, o->material, diffuseLight,
+                             (Vec4f){va->ndc.x, va->ndc.y, va->ndc.z, va->invW},
+                             (Vec4f){vb->ndc.x, vb->ndc.y, vb->ndc.z, vb->invW},
+                             (Vec4f){vc->ndc.x, vc->ndc.y, vc->ndc.z, vc->invW},
+                             tca, tcb, tcc);
+}
 
-        //Triangle is completely behind camera
-        if (a.z > 0 && b.z > 0 && c.z > 0)
-            continue;
+// State of a mesh draw shared by the helpers below
+typedef struct ObjectDraw {
+    Renderer *r;
+    Object *o;
+    Mat4 vm;       // Model view matrix
+    Mat4 p;        // Projection matrix
+    Vec2f guard;
+    bool cached;   // Positions go through the renderer vertex cache
+    Vec3f eye;     // Camera position in mesh space, used with meshlets
+} ObjectDraw;
+
+// Range of indices of meshlet m, false when the meshlet is outside the
+// frustum or facing away. Without meshlets the whole mesh is one range
+static bool object_meshlet_range(ObjectDraw *d, int m, int *first, int *last)
+{
+    Mesh *mesh = d->o->mesh;
+    if (mesh->meshlets_count == 0) {
+        *first = 0;
+        *last = mesh->indexes_count;
+        return true;
+    }
+
+    const Meshlet *meshlet = &mesh->meshlets[m];
+    if (meshlet_backfacing(meshlet, d->eye))
+        return false;
+    if (frustum_cull_sphere(&d->r->frustum, sphere_transform(meshlet->bounds, &d->vm)))
+        return false;
+
+    *first = meshlet->first;
+    *last = meshlet->first + meshlet->count;
+    return true;
+}
+
+// Vertex stage of the corners of the face starting at index i. Cached
+// positions are transformed the first time a face uses them, otherwise
+// they are transformed into corners
+static inline void object_face_vertices(ObjectDraw *d, int i, Vertex corners[3],
+                                        const Vertex *v[3])
+{
+    Mesh *mesh = d->o->mesh;
+    for (int k = 0; k < 3; k++) {
+        uint16_t index = mesh->pos_indices[i + k];
+        Vertex *out = d->cached ? &d->r->vertex_cache[index] : &corners[k];
+        if (!d->cached || !out->ready)
+            vertex_transform(out, &mesh->positions[index], 1, &d->vm, &d->p, d->guard);
+        v[k] = out;
+    }
+}
 
-        // convert to device coordinates by perspective division
-        //a.w = 1.0 / a.w;
-        //b.w = 1.0 / b.w;
-        //c.w = 1.0 / c.w;
-        a.x /= a.w;
-        a.y /= a.w;
-        a.z /= a.w;
-        a.w = 1;
-        b.x /= b.w;
-        b.y /= b.w;
-        b.z /= b.w;
-        b.w = 1;
-        c.x /= c.w;
-        c.y /= c.w;
-        c.z /= c.w;
-        c.w = 1;
-
-        float clocking = isClockWise(a.x, a.y, b.x, b.y, c.x, c.y);
-        if (clocking >= 0)
+// Draws the visible faces of a mesh whose positions are in the vertex cache
+// nearest first. Faces are counting sorted into coarse buckets by the view
+// distance of their nearest corner, which is enough for most fragments
+// hidden behind other faces of the mesh to fail the depth test
+static void object_draw_sorted(ObjectDraw *d)
+{
+    Renderer *r = d->r;
+    Mesh *mesh = d->o->mesh;
+    int faces = mesh->indexes_count / 3;
+
+    Sphere bounds = sphere_transform(mesh_bounds(mesh), &d->vm);
+    float nearest = -bounds.center.z - bounds.radius;
+    float farthest = -bounds.center.z + bounds.radius;
+    float scale = farthest > nearest ? (OBJECT_FACE_BUCKETS - 1) / (farthest - nearest) : 0;
+
+    uint32_t counts[OBJECT_FACE_BUCKETS] = {0};
+    for (int f = 0; f < faces; f++)
+        r->face_buckets[f] = OBJECT_FACE_CULLED;
+
+    for (int m = 0; m < MAX(mesh->meshlets_count, 1); m++) {
+        int first, last;
+        if (!object_meshlet_range(d, m, &first, &last))
             continue;
 
-        //Compute Screen coordinates
-        float halfX = scrSize.x / 2;
-        float halfY = scrSize.y / 2;
-        Vec2i a_s = {a.x * halfX + halfX, a.y * halfY + halfY};
-        Vec2i b_s = {b.x * halfX + halfX, b.y * halfY + halfY};
-        Vec2i c_s = {c.x * halfX + halfX, c.y * halfY + halfY};
+        for (int i = first; i < last; i += 3) {
+            const Vertex *v[3];
+            object_face_vertices(d, i, 0, v);
+            if (!object_face_visible(v[0], v[1], v[2]))
+                continue;
+
+            float depth = MIN(MIN(-v[0]->view.z, -v[1]->view.z), -v[2]->view.z);
+            uint8_t bucket = MIN(MAX((depth - nearest) * scale, 0), OBJECT_FACE_BUCKETS - 1);
+            r->face_buckets[i / 3] = bucket;
+            counts[bucket]++;
+        }
+    }
+
+    //Turn the counts into the first slot of each bucket
+    uint32_t visible = 0;
+    for (int b = 0; b < OBJECT_FACE_BUCKETS; b++) {
+        uint32_t count = counts[b];
+        counts[b] = visible;
+        visible += count;
+    }
+
+    for (int f = 0; f < faces; f++) {
+        uint8_t bucket = r->face_buckets[f];
+        if (bucket != OBJECT_FACE_CULLED)
+            r->face_order[counts[bucket]++] = f;
+    }
 
-        int32_t minX = MIN(MIN(a_s.x, b_s.x), c_s.x);
-        int32_t minY = MIN(MIN(a_s.y, b_s.y), c_s.y);
-        int32_t maxX = MAX(MAX(a_s.x, b_s.x), c_s.x);
-        int32_t maxY = MAX(MAX(a_s.y, b_s.y), c_s.y);
+    const Vertex *cache = r->vertex_cache;
+    for (uint32_t k = 0; k < visible; k++) {
+        int i = r->face_order[k] * 3;
+        object_draw_face(r, d->o, i,
+                         &cache[mesh->pos_indices[i + 0]],
+                         &cache[mesh->pos_indices[i + 1]],
+                         &cache[mesh->pos_indices[i + 2]],
+                         d->guard);
+    }
+}
 
-        minX = MIN(MAX(minX, 0), r->framebuffer.size.x);
-        minY = MIN(MAX(minY, 0), r->framebuffer.size.y);
-        maxX = MIN(MAX(maxX, 0), r->framebuffer.size.x);
-        maxY = MIN(MAX(maxY, 0), r->framebuffer.size.y);
+int object_render(void *this, Mat4 m, Renderer *r)
+{
+    Object *o = this;
 
-        // Barycentric coordinates at minX/minY corner
-        Vec2i minTriangle = {minX, minY};
+    IF_NULL_RETURN(o, RENDER_ERROR);
+    IF_NULL_RETURN(r, RENDER_ERROR);
 
-        int32_t area = orient2d(a_s, b_s, c_s);
-        if (area == 0)
+    Mesh *mesh = o->mesh;
+    ObjectDraw d;
+    d.r = r;
+    d.o = o;
+    d.guard = clip_guard(r->framebuffer.size);
+
+    // VIEW MATRIX
+    d.p = r->camera_projection;
+    d.vm = mat4MultiplyM(&r->view, &m);
+
+    // Occluder pass: occluders only go to the occlusion buffer
+    if (r->occlusion != 0 && r->occlusion->rasterizing)
+        return o->occluder ? occlusion_add_mesh(r->occlusion, r, mesh, &d.vm) : OK;
+
+    // Defer the draw to the render queue, keyed by the view distance of the
+    // mesh bounds
+    if (r->queue != 0 && !r->queue->draining) {
+        Sphere bounds = sphere_transform(mesh_bounds(mesh), &d.vm);
+        return queue_push(r->queue, r, this, m, -bounds.center.z);
+    }
+
+    if (mesh->meshlets_count > 0) {
+        Mat4 inverse = mat4Inverse(&d.vm);
+        Vec4f eye = mat4MultiplyVec4(&(Vec4f){0, 0, 0, 1}, &inverse);
+        d.eye = (Vec3f){eye.x, eye.y, eye.z};
+    }
+
+    // Vertex stage: when the mesh fits in the renderer vertex cache every
+    // position is transformed once and triangles just gather them, otherwise
+    // triangle corners are transformed one by one. With meshlets only the
+    // positions of the meshlets that survive culling are transformed
+    int positions = mesh_positions_count(mesh);
+    d.cached = r->vertex_cache != 0 && positions <= r->vertex_cache_size;
+    if (d.cached && mesh->meshlets_count > 0) {
+        for (int i = 0; i < positions; i++)
+            r->vertex_cache[i].ready = false;
+    } else if (d.cached) {
+        vertex_transform(r->vertex_cache, mesh->positions, positions, &d.vm, &d.p, d.guard);
+    }
+
+    if (d.cached && mesh->indexes_count / 3 <= r->face_sort_size) {
+        object_draw_sorted(&d);
+        return OK;
+    }
+
+    for (int k = 0; k < MAX(mesh->meshlets_count, 1); k++) {
+        int first, last;
+        if (!object_meshlet_range(&d, k, &first, &last))
             continue;
-        float areaInverse = 1.0 / area;
-
-        int32_t A01 = (a_s.y - b_s.y); //Barycentric coordinates steps
-        int32_t B01 = (b_s.x - a_s.x); //Barycentric coordinates steps
-        int32_t A12 = (b_s.y - c_s.y); //Barycentric coordinates steps
-        int32_t B12 = (c_s.x - b_s.x); //Barycentric coordinates steps
-        int32_t A20 = (c_s.y - a_s.y); //Barycentric coordinates steps
-        int32_t B20 = (a_s.x - c_s.x); //Barycentric coordinates steps
-
-        int32_t w0_row = orient2d(b_s, c_s, minTriangle);
-        int32_t w1_row = orient2d(c_s, a_s, minTriangle);
-        int32_t w2_row = orient2d(a_s, b_s, minTriangle);
-
-        if (o->material != 0) {
-            tca.x /= a.z;
-            tca.y /= a.z;
-            tcb.x /= b.z;
-            tcb.y /= b.z;
-            tcc.x /= c.z;
-            tcc.y /= c.z;
-        }
 
-        for (int16_t y = minY; y < maxY; y++, w0_row += B12, w1_row += B20, w2_row += B01) {
-            int32_t w0 = w0_row;
-            int32_t w1 = w1_row;
-            int32_t w2 = w2_row;
-
-            for (int32_t x = minX; x < maxX; x++, w0 += A12, w1 += A20, w2 += A01) {
-                if ((w0 | w1 | w2) < 0)
-                    continue;
-
-                float depth = -(w0 * a.z + w1 * b.z + w2 * c.z) * areaInverse;
-                if (depth < -1.0 || depth > 1.0)
-                    continue;
-
-                if (depth_check(r->backend->getZetaBuffer(r, r->backend),
-                                x + y * scrSize.x,
-                                depth))
-                    continue;
-
-                depth_write(r->backend->getZetaBuffer(r, r->backend), x + y * scrSize.x, depth);
-
-                if (o->material != 0) {
-                    //Texture lookup
-
-                    float textCoordx = -(w0 * tca.x + w1 * tcb.x + w2 * tcc.x) * areaInverse * depth;
-                    float textCoordy = -(w0 * tca.y + w1 * tcb.y + w2 * tcc.y) * areaInverse * depth;
-
-                    Pixel text = texture_readF(o->material->texture,
-                                               (Vec2f){textCoordx, textCoordy});
-                    texture_draw(&r->framebuffer, (Vec2i){x, y}, pixelMul(text, diffuseLight));
-                } else {
-                    texture_draw(&r->framebuffer,
-                                 (Vec2i){x, y},
-                                 pixelMul(pixelFromUInt8(255), diffuseLight));
-                }
-            }
+        for (int i = first; i < last; i += 3) {
+            Vertex corners[3];
+            const Vertex *v[3];
+            object_face_vertices(&d, i, corners, v);
+            if (object_face_visible(v[0], v[1], v[2]))
+                object_draw_face(r, o, i, v[0], v[1], v[2], d.guard);
         }
     }
 
     return OK;
 };
 
+static Sphere object_bounds(void *this)
+{
+    Object *o = this;
+    return mesh_bounds(o->mesh);
+}
+
 int object_init(Object *this, Mesh *mesh, Material *material)
 {
     IF_NULL_RETURN(this, INIT_ERROR);
@@ -178,7 +353,9 @@ int object_init(Object *this, Mesh *mesh, Material *material)
 
     this->material = material;
     this->mesh = mesh;
+    this->occluder = false;
     this->renderable.render = &object_render;
+    this->renderable.bounds = &object_bounds;
 
     return OK;
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "renderable.h"
+#include <stdbool.h>
 
 typedef struct Mesh Mesh;
 typedef struct Material Material;
@@ -9,6 +10,7 @@ typedef struct Object {
   Renderable renderable;
   Mesh *mesh;
   Material *material;
+  bool occluder; // Rasterized into the occlusion buffer, see occlusion.h
 } Object;
 
 extern int object_init(Object *this, Mesh *mesh, Material *material);
@@ -0,0 +1,164 @@
+#include "occlusion.h"
+#include "clip.h"
+#include "math/fun.h"
+#include "mesh.h"
+#include "renderer.h"
+#include "state.h"
+#include "vertex.h"
+
+#include <math.h>
+#include <string.h>
+
+int occlusion_init(Occlusion *this, Vec2i size, PingoDepth *depth)
+{
+    IF_NULL_RETURN(this, INIT_ERROR);
+    IF_NULL_RETURN(depth, INIT_ERROR);
+
+    if (size.x * size.y == 0)
+        return INIT_ERROR;
+
+    this->size = size;
+    this->depth = depth;
+    this->rasterizing = false;
+    occlusion_clear(this);
+
+    return OK;
+}
+
+void occlusion_clear(Occlusion *this)
+{
+    memset(this->depth, 0, this->size.x * this->size.y * sizeof(PingoDepth));
+}
+
+// Rasterizes a triangle given in device coordinates
+static void occlusion_triangle(Occlusion *this, Vec3f a, Vec3f b, Vec3f c)
+{
+    float halfX = this->size.x * 0.5f;
+    float halfY = this->size.y * 0.5f;
+    Vec2f sa = {a.x * halfX + halfX, a.y * halfY + halfY};
+    Vec2f sb = {b.x * halfX + halfX, b.y * halfY + halfY};
+    Vec2f sc = {c.x * halfX + halfX, c.y * halfY + halfY};
+
+    float area = (sb.x - sa.x) * (sc.y - sa.y) - (sb.y - sa.y) * (sc.x - sa.x);
+    if (area <= 0)
+        return;
+
+    //Depth is stored negated, see triangle.c
+    float za = -a.z, zb = -b.z, zc = -c.z;
+    if (MIN(MIN(za, zb), zc) < 0 || MAX(MAX(za, zb), zc) >= 1)
+        return;
+
+    int32_t minX = MAX((int32_t)floorf(MIN(MIN(sa.x, sb.x), sc.x)), 0);
+    int32_t minY = MAX((int32_t)floorf(MIN(MIN(sa.y, sb.y), sc.y)), 0);
+    int32_t maxX = MIN((int32_t)ceilf(MAX(MAX(sa.x, sb.x), sc.x)), this->size.x);
+    int32_t maxY = MIN((int32_t)ceilf(MAX(MAX(sa.y, sb.y), sc.y)), this->size.y);
+
+    // Barycentric coordinates of b and c as planes over the pixel centers
+    float inverse = 1.0f / area;
+    float b0 = ((sc.y - sa.y) * (minX + 0.5f - sc.x) + (sa.x - sc.x) * (minY + 0.5f - sc.y)) * inverse;
+    float bDx = (sc.y - sa.y) * inverse, bDy = (sa.x - sc.x) * inverse;
+    float c0 = ((sa.y - sb.y) * (minX + 0.5f - sa.x) + (sb.x - sa.x) * (minY + 0.5f - sa.y)) * inverse;
+    float cDx = (sa.y - sb.y) * inverse, cDy = (sb.x - sa.x) * inverse;
+
+    //Largest drop of each barycentric coordinate from the pixel center to a
+    //corner: the triangle covers the pixel when none falls below zero. The
+    //drops are widened a little against rounding
+    float bSlack = (fabsf(bDx) + fabsf(bDy)) * 0.501f;
+    float cSlack = (fabsf(cDx) + fabsf(cDy)) * 0.501f;
+    float aSlack = (fabsf(bDx + cDx) + fabsf(bDy + cDy)) * 0.501f;
+
+    float depthDx = bDx * (zb - za) + cDx * (zc - za);
+    float depthDy = bDy * (zb - za) + cDy * (zc - za);
+    //From the pixel center to its farthest corner
+    float slack = (fabsf(depthDx) + fabsf(depthDy)) * 0.5f;
+
+    for (int32_t y = minY; y < maxY; y++) {
+        float wb = b0 + (y - minY) * bDy;
+        float wc = c0 + (y - minY) * cDy;
+        for (int32_t x = minX; x < maxX; x++, wb += bDx, wc += cDx) {
+            if (wb < bSlack || wc < cSlack || wb + wc + aSlack > 1)
+                continue;
+
+            float depth = za + wb * (zb - za) + wc * (zc - za) - slack;
+            int idx = x + y * this->size.x;
+            if (!depth_check(this->depth, idx, depth))
+                depth_write(this->depth, idx, depth);
+        }
+    }
+}
+
+int occlusion_add_mesh(Occlusion *this, Renderer *r, Mesh *mesh, Mat4 *modelView)
+{
+    IF_NULL_RETURN(this, RENDER_ERROR);
+    IF_NULL_RETURN(mesh, RENDER_ERROR);
+
+    Mat4 p = r->camera_projection;
+    Vec2f guard = clip_guard(this->size);
+
+    for (int i = 0; i < mesh->indexes_count; i += 3) {
+        Vertex v[3];
+        for (int k = 0; k < 3; k++)
+            vertex_transform(&v[k], &mesh->positions[mesh->pos_indices[i + k]], 1, modelView, &p, guard);
+
+        if (v[0].clip_flags & v[1].clip_flags & v[2].clip_flags & CLIP_FRUSTUM)
+            continue;
+        if ((v[0].clip_flags | v[1].clip_flags | v[2].clip_flags) & CLIP_NEEDED)
+            continue;
+
+        occlusion_triangle(this, v[0].ndc, v[1].ndc, v[2].ndc);
+    }
+
+    return OK;
+}
+
+bool occlusion_test_sphere(Occlusion *this, Renderer *r, Sphere s)
+{
+    if (s.radius < 0)
+        return false;
+
+    Mat4 *p = &r->camera_projection;
+
+    //Project the corners of the cube around the sphere to get a screen rect
+    float lo[2] = {INFINITY, INFINITY};
+    float hi[2] = {-INFINITY, -INFINITY};
+    for (int corner = 0; corner < 8; corner++) {
+        Vec4f v = {s.center.x + (corner & 1 ? s.radius : -s.radius),
+                   s.center.y + (corner & 2 ? s.radius : -s.radius),
+                   s.center.z + (corner & 4 ? s.radius : -s.radius), 1};
+        Vec4f c = mat4MultiplyVec4(&v, p);
+        //Crosses the near plane, no useful rect
+        if (c.w < CLIP_W_MIN || c.z < -c.w)
+            return false;
+        lo[0] = MIN(lo[0], c.x / c.w);
+        lo[1] = MIN(lo[1], c.y / c.w);
+        hi[0] = MAX(hi[0], c.x / c.w);
+        hi[1] = MAX(hi[1], c.y / c.w);
+    }
+
+    //Depth of the nearest point of the sphere
+    Vec4f nearest = {s.center.x, s.center.y, s.center.z + s.radius, 1};
+    Vec4f c = mat4MultiplyVec4(&nearest, p);
+    float depth = -c.z / c.w;
+    if (depth < 0 || depth >= 1)
+        return false;
+
+    float halfX = this->size.x * 0.5f;
+    float halfY = this->size.y * 0.5f;
+    int32_t minX = MAX((int32_t)floorf(lo[0] * halfX + halfX), 0);
+    int32_t minY = MAX((int32_t)floorf(lo[1] * halfY + halfY), 0);
+    int32_t maxX = MIN((int32_t)ceilf(hi[0] * halfX + halfX), this->size.x);
+    int32_t maxY = MIN((int32_t)ceilf(hi[1] * halfY + halfY), this->size.y);
+
+    //Outside of the screen, frustum culling decides
+    if (minX >= maxX || minY >= maxY)
+        return false;
+
+    for (int32_t y = minY; y < maxY; y++) {
+        for (int32_t x = minX; x < maxX; x++) {
+            if (!depth_check(this->depth, x + y * this->size.x, depth))
+                return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "bounds.h"
+#include "depth.h"
+#include "math/mat4.h"
+#include "math/vec2.h"
+
+typedef struct Renderer Renderer;
+typedef struct Mesh Mesh;
+
+/**
+ * Software occlusion culling.
+ *
+ * Each frame starts with an occluder pass: the scene is walked once and the
+ * objects flagged as occluders are rasterized, depth only, into a small depth
+ * buffer covering the whole screen, e.g. 256x128. The regular pass then tests
+ * the bounding sphere of every entity against it and skips entities, with
+ * their subtree, that are entirely behind the occluders.
+ *
+ * Occluder pixels are only written where a single triangle covers them
+ * entirely, with the farthest depth the triangle reaches inside the pixel,
+ * and occluder triangles needing clipping are skipped. The occluders are
+ * thereby never larger nor nearer than they are: an entity may be drawn
+ * though hidden, e.g. behind pixels shared by several occluder triangles,
+ * but is never skipped while visible.
+ */
+
+typedef struct Occlusion {
+  Vec2i size;
+  PingoDepth *depth; // size.x * size.y elements
+  bool rasterizing;  // Set during the occluder pass
+} Occlusion;
+
+extern int occlusion_init(Occlusion *this, Vec2i size, PingoDepth *depth);
+
+extern void occlusion_clear(Occlusion *this);
+
+/// Rasterizes the mesh, with the given model view matrix, as an occluder
+extern int occlusion_add_mesh(Occlusion *this, Renderer *r, Mesh *mesh, Mat4 *modelView);
+
+/// True when the sphere, in view space, is hidden behind the occluders
+/// rasterized so far
+extern bool occlusion_test_sphere(Occlusion *this, Renderer *r, Sphere s);
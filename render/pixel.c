@@ -1,5 +1,7 @@
 #include "pixel.h"
 
+#define PIXEL_LERP(a, b, t) ((uint8_t)(((a) * (256 - (t)) + (b) * (t) + 128) >> 8))
+
 #ifdef PINGO_PIXEL_UINT8
 
 extern Pixel pixelRandom() {
@@ -24,6 +26,67 @@ extern Pixel pixelFromRGBA( uint8_t r, uint8_t g, uint8_t b, uint8_t a)
 {
     return (Pixel){((r + g + b) / 3)};
 }
+
+extern Pixel pixelBlend(Pixel a, Pixel b, uint8_t t)
+{
+    return (Pixel){PIXEL_LERP(a.g, b.g, t)};
+}
+
+uint32_t pixelToRGBA(Pixel * p)
+{
+    return p->g | p->g << 8 | p->g << 16 | 255u << 24;
+}
+#endif
+
+#ifdef PINGO_PIXEL_RGB565
+
+#define PIXEL_RED(p) ((p).rgb >> 11)
+#define PIXEL_GREEN(p) (((p).rgb >> 5) & 0x3F)
+#define PIXEL_BLUE(p) ((p).rgb & 0x1F)
+
+static inline Pixel pixelPack(uint32_t r, uint32_t g, uint32_t b)
+{
+    return (Pixel){(uint16_t)(r << 11 | g << 5 | b)};
+}
+
+extern Pixel pixelRandom() {
+    return (Pixel){(uint16_t)rand()};
+}
+
+extern Pixel pixelFromUInt8( uint8_t g){
+    return pixelPack(g >> 3, g >> 2, g >> 3);
+}
+
+extern uint8_t pixelToUInt8( Pixel * p){
+    uint32_t rgba = pixelToRGBA(p);
+    return ((rgba & 0xFF) + ((rgba >> 8) & 0xFF) + ((rgba >> 16) & 0xFF)) / 3;
+}
+
+uint32_t pixelToRGBA(Pixel * p)
+{
+    //Low bits repeat the high ones, so that white stays 255
+    uint32_t r = PIXEL_RED(*p), g = PIXEL_GREEN(*p), b = PIXEL_BLUE(*p);
+    r = r << 3 | r >> 2;
+    g = g << 2 | g >> 4;
+    b = b << 3 | b >> 2;
+    return r | g << 8 | b << 16 | 255u << 24;
+}
+
+extern Pixel pixelFromRGBA( uint8_t r, uint8_t g, uint8_t b, uint8_t a){
+    return pixelPack(r >> 3, g >> 2, b >> 3);
+}
+
+extern Pixel pixelMul(Pixel p, float f)
+{
+    return pixelPack(PIXEL_RED(p) * f, PIXEL_GREEN(p) * f, PIXEL_BLUE(p) * f);
+}
+
+extern Pixel pixelBlend(Pixel a, Pixel b, uint8_t t)
+{
+    return pixelPack(PIXEL_LERP(PIXEL_RED(a), PIXEL_RED(b), t),
+                     PIXEL_LERP(PIXEL_GREEN(a), PIXEL_GREEN(b), t),
+                     PIXEL_LERP(PIXEL_BLUE(a), PIXEL_BLUE(b), t));
+}
 #endif
 
 #ifdef PINGO_PIXEL_RGB888
@@ -33,8 +96,7 @@ extern Pixel pixelRandom() {
 
 uint32_t pixelToRGBA(Pixel * p)
 {
-    uint8_t g = p->g;
-    uint32_t a = p->r | p->g <<8 | p->b<<16| 255<<24;
+    uint32_t a = p->r | p->g <<8 | p->b<<16| 255u<<24;
     return a;
 }
 
@@ -54,6 +116,11 @@ extern uint8_t pixelToUInt8( Pixel * p){
 extern Pixel pixelFromRGBA( uint8_t r, uint8_t g, uint8_t b, uint8_t a){
     return (Pixel){r,g,b};
 }
+
+extern Pixel pixelBlend(Pixel a, Pixel b, uint8_t t)
+{
+    return (Pixel){PIXEL_LERP(a.r, b.r, t), PIXEL_LERP(a.g, b.g, t), PIXEL_LERP(a.b, b.b, t)};
+}
 #endif
 
 #ifdef PINGO_PIXEL_RGBA8888
@@ -77,6 +144,17 @@ extern Pixel pixelMul(Pixel p, float f)
     return (Pixel){p.r*f,p.g*f,p.b*f,p.a};
 }
 
+extern Pixel pixelBlend(Pixel a, Pixel b, uint8_t t)
+{
+    return (Pixel){PIXEL_LERP(a.r, b.r, t), PIXEL_LERP(a.g, b.g, t),
+                   PIXEL_LERP(a.b, b.b, t), PIXEL_LERP(a.a, b.a, t)};
+}
+
+uint32_t pixelToRGBA(Pixel * p)
+{
+    return p->r | p->g << 8 | p->b << 16 | (uint32_t)p->a << 24;
+}
+
 #endif
 
 
@@ -102,4 +180,15 @@ extern Pixel pixelMul(Pixel p, float f)
     return (Pixel){p.b*f,p.g*f,p.r*f,p.a};
 }
 
+extern Pixel pixelBlend(Pixel a, Pixel b, uint8_t t)
+{
+    return (Pixel){PIXEL_LERP(a.b, b.b, t), PIXEL_LERP(a.g, b.g, t),
+                   PIXEL_LERP(a.r, b.r, t), PIXEL_LERP(a.a, b.a, t)};
+}
+
+uint32_t pixelToRGBA(Pixel * p)
+{
+    return p->r | p->g << 8 | p->b << 16 | (uint32_t)p->a << 24;
+}
+
 #endif
@@ -3,12 +3,18 @@
 #include <stdint.h>
 #include <stdlib.h>
 
-// Define one of the available formats
+// Define one of the available formats, BGRA8888 unless the build picks one
+// (see PINGO_PIXEL in CMakeLists.txt)
 // #define PINGO_PIXEL_UINT8
 // #define PINGO_PIXEL_RGB565
 // #define PINGO_PIXEL_RGBA8888
-#define PINGO_PIXEL_BGRA8888
+// #define PINGO_PIXEL_BGRA8888
 // #define PINGO_PIXEL_RGB888
+#if !defined(PINGO_PIXEL_UINT8) && !defined(PINGO_PIXEL_RGB565) &&             \
+    !defined(PINGO_PIXEL_RGBA8888) && !defined(PINGO_PIXEL_BGRA8888) &&        \
+    !defined(PINGO_PIXEL_RGB888)
+#define PINGO_PIXEL_BGRA8888
+#endif
 
 // Formats definitions:
 #ifdef PINGO_PIXEL_UINT8
@@ -22,15 +28,15 @@ typedef struct Pixel {
 #endif
 
 #ifdef PINGO_PIXEL_RGB565
+// Red in the 5 high bits, green in the 6 middle ones and blue in the 5 low
+// ones, in the byte order of the CPU
 typedef struct Pixel {
-  uint8_t red : 5;
-  uint8_t green : 6;
-  uint8_t blue : 5;
+  uint16_t rgb;
 } Pixel;
 #define PIXELBLACK                                                             \
   (Pixel) { 0 }
 #define PIXELWHITE                                                             \
-  (Pixel) { 255 }
+  (Pixel) { 0xFFFF }
 #endif
 
 #ifdef PINGO_PIXEL_RGB888
@@ -78,5 +84,107 @@ typedef struct Pixel {
 extern Pixel pixelRandom();
 extern Pixel pixelFromUInt8(uint8_t);
 extern uint8_t pixelToUInt8(Pixel *);
+// Red in the low byte, alpha in the high one
+extern uint32_t pixelToRGBA(Pixel *);
 extern Pixel pixelFromRGBA(uint8_t r, uint8_t g, uint8_t b, uint8_t a);
 extern Pixel pixelMul(Pixel p, float f);
+// a moved towards b by t / 256
+extern Pixel pixelBlend(Pixel a, Pixel b, uint8_t t);
+
+/**
+ * Shading.
+ *
+ * pixelShade scales the color channels of a pixel by light / 256 with
+ * integer multiplies, the light of a triangle being converted to fixed point
+ * once. 32 bit pixels are scaled all channels at once, spread over the
+ * lanes of a 64 bit integer (see pixelWiden).
+ *
+ * RGB565 pixels drop the fraction of the scaled channels, which bands
+ * smooth shading in steps of 8 levels of red and blue. They are dithered
+ * instead: a 4x4 Bayer matrix threshold, indexed by the screen position
+ * x/y, is added to the fraction before it is dropped, so neighbouring
+ * pixels round differently and average to the exact shade.
+ */
+
+#if defined(PINGO_PIXEL_BGRA8888) || defined(PINGO_PIXEL_RGBA8888)
+#include <string.h>
+
+// The 4 channels of a 32 bit pixel spread over the 16 bit lanes of a 64 bit
+// integer: a lerp of all of them is two multiplies, an add and a shift, the
+// products of 8 bit channels by 8.8 weights never crossing a lane
+static inline uint64_t pixelWiden(Pixel p)
+{
+  uint32_t v;
+  memcpy(&v, &p, sizeof(v));
+  uint64_t w = v;
+  w = (w | (w << 16)) & 0x0000FFFF0000FFFFull;
+  return (w | (w << 8)) & 0x00FF00FF00FF00FFull;
+}
+
+static inline Pixel pixelNarrow(uint64_t w)
+{
+  w = (w | (w >> 8)) & 0x0000FFFF0000FFFFull;
+  uint32_t v = (uint32_t)(w | (w >> 16));
+  Pixel p;
+  memcpy(&p, &v, sizeof(p));
+  return p;
+}
+
+static inline uint64_t pixelLerpWide(uint64_t a, uint64_t b, uint32_t t)
+{
+  return ((a * (256 - t) + b * t) >> 8) & 0x00FF00FF00FF00FFull;
+}
+
+// Bilinear blend of 4 pixels, tx and ty being the weights of the right and
+// bottom pixels out of 256
+static inline Pixel pixelBilinear(Pixel p00, Pixel p10, Pixel p01, Pixel p11, uint32_t tx, uint32_t ty)
+{
+  uint64_t top = pixelLerpWide(pixelWiden(p00), pixelWiden(p10), tx);
+  uint64_t bottom = pixelLerpWide(pixelWiden(p01), pixelWiden(p11), tx);
+  return pixelNarrow(pixelLerpWide(top, bottom, ty));
+}
+
+// p with its color scaled by light / 256, light up to 256, alpha kept
+static inline Pixel pixelShade(Pixel p, uint32_t light, int32_t x, int32_t y)
+{
+  (void)x;
+  (void)y;
+  uint64_t w = pixelWiden(p);
+  uint64_t alpha = w & 0x00FF000000000000ull;
+  return pixelNarrow((((w * light) >> 8) & 0x000000FF00FF00FFull) | alpha);
+}
+#else
+static inline Pixel pixelBilinear(Pixel p00, Pixel p10, Pixel p01, Pixel p11, uint32_t tx, uint32_t ty)
+{
+  return pixelBlend(pixelBlend(p00, p10, tx), pixelBlend(p01, p11, tx), ty);
+}
+#endif
+
+#if defined(PINGO_PIXEL_RGB565)
+// Thresholds of the 4x4 Bayer matrix, in 1/256 of a channel step
+#define PIXEL_BAYER(x, y)                                                      \
+  (((0x5D7F91B36E4CA280ull >> ((((y) & 3) * 4 + ((x) & 3)) * 4)) & 0xF) * 16 + 8)
+
+static inline Pixel pixelShade(Pixel p, uint32_t light, int32_t x, int32_t y)
+{
+  //Red, green and blue in 16 bit lanes, where they never carry into the
+  //next one: 63 * 256 + 255 < 65536
+  uint64_t w = ((uint64_t)(p.rgb >> 11) << 32) | ((uint64_t)((p.rgb >> 5) & 0x3F) << 16) | (p.rgb & 0x1F);
+  w = (w * light + PIXEL_BAYER(x, y) * 0x0000000100010001ull) >> 8;
+  return (Pixel){(uint16_t)(((w >> 21) & 0xF800) | ((w >> 11) & 0x07E0) | (w & 0x1F))};
+}
+#elif defined(PINGO_PIXEL_RGB888)
+static inline Pixel pixelShade(Pixel p, uint32_t light, int32_t x, int32_t y)
+{
+  (void)x;
+  (void)y;
+  return (Pixel){(uint8_t)((p.r * light) >> 8), (uint8_t)((p.g * light) >> 8), (uint8_t)((p.b * light) >> 8)};
+}
+#elif defined(PINGO_PIXEL_UINT8)
+static inline Pixel pixelShade(Pixel p, uint32_t light, int32_t x, int32_t y)
+{
+  (void)x;
+  (void)y;
+  return (Pixel){(uint8_t)((p.g * light) >> 8)};
+}
+#endif
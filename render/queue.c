@@ -0,0 +1,65 @@
+#include "queue.h"
+#include "state.h"
+
+int queue_init(Queue *this, QueueItem *items, uint32_t items_capacity)
+{
+    IF_NULL_RETURN(this, INIT_ERROR);
+    IF_NULL_RETURN(items, INIT_ERROR);
+
+    if (items_capacity == 0)
+        return INIT_ERROR;
+
+    this->items = items;
+    this->items_capacity = items_capacity;
+    this->items_count = 0;
+    this->draining = false;
+
+    return OK;
+}
+
+int queue_push(Queue *this, Renderer *r, Renderable *renderable,
+               Mat4 transform, float depth)
+{
+    IF_NULL_RETURN(this, RENDER_ERROR);
+    IF_NULL_RETURN(renderable, RENDER_ERROR);
+
+    if (this->items_count == this->items_capacity)
+        queue_flush(this, r);
+
+    QueueItem *item = &this->items[this->items_count++];
+    item->renderable = renderable;
+    item->transform = transform;
+    item->depth = depth;
+
+    return OK;
+}
+
+int queue_flush(Queue *this, Renderer *r)
+{
+    IF_NULL_RETURN(this, RENDER_ERROR);
+    IF_NULL_RETURN(r, RENDER_ERROR);
+
+    if (this->draining || this->items_count == 0)
+        return OK;
+
+    //Insertion sort: scenes hold few objects and it keeps equal depths in order
+    for (uint32_t i = 1; i < this->items_count; i++) {
+        QueueItem item = this->items[i];
+        uint32_t j = i;
+        while (j > 0 && this->items[j - 1].depth > item.depth) {
+            this->items[j] = this->items[j - 1];
+            j--;
+        }
+        this->items[j] = item;
+    }
+
+    this->draining = true;
+    for (uint32_t i = 0; i < this->items_count; i++) {
+        QueueItem *item = &this->items[i];
+        item->renderable->render(item->renderable, item->transform, r);
+    }
+    this->draining = false;
+    this->items_count = 0;
+
+    return OK;
+}
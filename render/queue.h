@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "math/mat4.h"
+#include "renderable.h"
+
+/**
+ * Front-to-back draw ordering.
+ *
+ * When a queue is set on the renderer, objects are not drawn while the scene
+ * graph is walked. Instead each object is recorded with its world transform
+ * and the view space distance of its origin. On flush the draws are sorted
+ * nearest first, so farther fragments fail the depth test before any
+ * texturing is spent on them. Draws at the same distance keep their
+ * submission order.
+ *
+ * The items are provided by the caller. When the queue is full, the pending
+ * draws are flushed first.
+ */
+
+typedef struct QueueItem {
+  Renderable *renderable;
+  Mat4 transform;
+  float depth; // Distance along the view direction
+} QueueItem;
+
+typedef struct Queue {
+  QueueItem *items;
+  uint32_t items_capacity;
+  uint32_t items_count;
+  bool draining; // Set while the sorted draws are being rendered
+} Queue;
+
+extern int queue_init(Queue *this, QueueItem *items, uint32_t items_capacity);
+
+/// Records a draw, flushing the pending ones first when the queue is full
+extern int queue_push(Queue *this, Renderer *r, Renderable *renderable,
+                      Mat4 transform, float depth);
+
+/// Renders the pending draws nearest first and empties the queue. Does
+/// nothing when called while the queue is already being flushed
+extern int queue_flush(Queue *this, Renderer *r);
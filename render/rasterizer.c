@@ -32,6 +32,8 @@ int rasterizer_draw_pixel_perfect(Vec2i off, Renderer *r, Texture * src) {
     minX = MIN(des.size.x, MAX(minX, 0));
     minY = MIN(des.size.y, MAX(minY, 0));
 
+    renderer_touch_rect(r, (Vec4i){minX, minY, maxX, maxY});
+
     for (int y = minY; y < maxY; y++) {
         for (int x = minX; x < maxX; x++) {
             //Transform the coordinate back to sprite space
@@ -66,6 +68,8 @@ int rasterizer_draw_pixel_perfect_doubled(Vec2i off, Renderer *r, Texture * src)
     minX = MIN(des.size.x, MAX(minX, 0));
     minY = MIN(des.size.y, MAX(minY, 0));
 
+    renderer_touch_rect(r, (Vec4i){minX, minY, MIN(maxX + 1, des.size.x), MIN(maxY + 1, des.size.y)});
+
     for (int y = minY; y < maxY; y+=2) {
         for (int x = minX; x < maxX; x=x+2) {
             //Transform the coordinate back to sprite space
@@ -86,7 +90,8 @@ int rasterizer_draw_pixel_perfect_doubled(Vec2i off, Renderer *r, Texture * src)
     return 0;
 }
 
-int rasterizer_draw_transformed(Mat4 t, Renderer *r, Texture * src) {
+int rasterizer_draw_transformed(Mat4 t, Renderer *r, const Sampler * sampler) {
+    Texture * src = sampler->texture;
     Texture des = r->framebuffer;
 
     Mat4 inv = mat4Inverse(&t);
@@ -114,17 +119,15 @@ int rasterizer_draw_transformed(Mat4 t, Renderer *r, Texture * src) {
     minX = MIN(des.size.x, MAX(minX, 0));
     minY = MIN(des.size.y, MAX(minY, 0));
 
+    renderer_touch_rect(r, (Vec4i){minX, minY, MIN(maxX + 1, des.size.x), MIN(maxY + 1, des.size.y)});
+
     //Now we can iterate over the pixels of the axis-alignes-bounding-box (AABB) which contain the source frame
     for (int y = minY; y <= maxY; y++) {
         for (int x = minX; x <= maxX; x++) {
-
-
-#ifdef FILTERING_NEAREST
             //Transform the coordinate back to sprite space with the inverse tranform
             Vec2i desPos = {x,y};
-            Vec2f desPosF = (Vec2f){desPos.x+0.5,desPos.y+0.5};
+            Vec2f desPosF = (Vec2f){desPos.x+0.5f,desPos.y+0.5f};
             Vec2f srcPosF = mat4MultiplyVec2(&desPosF,&inv);
-            Vec2i srcPosI = vecFtoI(srcPosF);
 
             //TODO: Improve this check by precalculating start/end coord in loop with line intersection
             //We need to check if transformed coord are inside the frame
@@ -135,104 +138,10 @@ int rasterizer_draw_transformed(Mat4 t, Renderer *r, Texture * src) {
             if (srcPosF.y < 0) continue;
             if (srcPosF.x >= src->size.x) continue;
             if (srcPosF.y >= src->size.y) continue;
-            Pixel color = texture_read(src, srcPosI);
-#endif
-#ifdef FILTERING_BILINEAR
-            Vec2i desPos = {x,y};
-            Vec2f desPosF = (Vec2f){desPos.x+0.5f,desPos.y+0.5f};
-            Vec2f srcPosF = mat4Multiply(&desPosF,&inv);
 
-            //TODO: Improve this check by precalculating start/end coord in loop with line intersection
-            //We need to check if transformed coord are inside the frame
-            //Probably there is a faster way of doing this by checking line intersection
-            //with the sprite transformed quad but I don't care for now because we
-            //do not use rotations as of now.
-            if (srcPosF.x < 0) continue;
-            if (srcPosF.y < 0) continue;
-            if (srcPosF.x >= src->size.x-1) continue;
-            if (srcPosF.y >= src->size.y-1) continue;
-
-            Pixel color = frameReadBilinear(src, srcPosF);
-#endif
-#ifdef FILTERING_ANISOTROPIC //4X
-            Vec2i desPos = {x,y};
-            Vec2f desPosF1 = (Vec2f){desPos.x+0.25f,desPos.y+0.25f};
-            Vec2f desPosF2 = (Vec2f){desPos.x+0.75f,desPos.y+0.75f};
-            Vec2f srcPosF1 = mat4Multiply(&desPosF1,&inv);
-            Vec2f srcPosF2 = mat4Multiply(&desPosF2,&inv);
-
-            if (srcPosF1.x < 0 && srcPosF2.x < 0) continue;
-            if (srcPosF1.y < 0 && srcPosF2.y < 0) continue;
-            if (srcPosF1.x > src->size.x && srcPosF2.x > src->size.x) continue;
-            if (srcPosF1.y > src->size.y && srcPosF2.y > src->size.y) continue;
-
-            Vec2i srcPosI1 = vec2iClamp((Vec2i) {srcPosF1.x,srcPosF1.y},(Vec2i){0,0},src->size);
-            Vec2i srcPosI2 = vec2iClamp((Vec2i) {srcPosF1.x,srcPosF2.y},(Vec2i){0,0},src->size);
-            Vec2i srcPosI3 = vec2iClamp((Vec2i) {srcPosF2.x,srcPosF1.y},(Vec2i){0,0},src->size);
-            Vec2i srcPosI4 = vec2iClamp((Vec2i) {srcPosF2.x,srcPosF2.y},(Vec2i){0,0},src->size);
-
-            float p1 = src->frameBuffer[(int)(srcPosI1.x + srcPosI1.y * src->size.x)].g;
-            float p2 = src->frameBuffer[(int)(srcPosI2.x + srcPosI2.y * src->size.x)].g;
-            float p3 = src->frameBuffer[(int)(srcPosI3.x + srcPosI3.y * src->size.x)].g;
-            float p4 = src->frameBuffer[(int)(srcPosI4.x + srcPosI4.y * src->size.x)].g;
-
-            Pixel color = {(p1+p2+p3+p4) / 4};
-#endif
-#ifdef FILTERING_ANISOTROPICX2 //8X
-            Vec2i desPos = {x,y};
-            Vec2f desPosF1  = (Vec2f){desPos.x+0.125f,desPos.y+0.125f};
-            Vec2f desPosF2  = (Vec2f){desPos.x+0.375f,desPos.y+0.375f};
-            Vec2f desPosF3  = (Vec2f){desPos.x+0.625f,desPos.y+0.625f};
-            Vec2f desPosF4  = (Vec2f){desPos.x+0.875f,desPos.y+0.875f};
-
-            Vec2f srcPosF1  = mat4MultiplyVec2(&desPosF1,&inv);
-            Vec2f srcPosF2  = mat4MultiplyVec2(&desPosF2,&inv);
-            Vec2f srcPosF3  = mat4MultiplyVec2(&desPosF3,&inv);
-            Vec2f srcPosF4  = mat4MultiplyVec2(&desPosF4,&inv);
-
-            if (srcPosF1.x < 0 && srcPosF2.x < 0 && srcPosF3.x < 0 && srcPosF4.x < 0) continue;
-            if (srcPosF1.y < 0 && srcPosF2.y < 0 && srcPosF3.y < 0 && srcPosF4.y < 0) continue;
-            if (srcPosF1.x > src->size.x && srcPosF2.x > src->size.x &&
-                srcPosF3.x > src->size.x && srcPosF4.x > src->size.x) continue;
-            if (srcPosF1.y > src->size.y && srcPosF2.y > src->size.y &&
-                srcPosF3.y > src->size.y && srcPosF4.y > src->size.y) continue;
-
-            Vec2i srcPosI1  = vec2iClamp((Vec2i) {srcPosF1.x,srcPosF1.y},(Vec2i){0,0},src->size);
-            Vec2i srcPosI2  = vec2iClamp((Vec2i) {srcPosF1.x,srcPosF2.y},(Vec2i){0,0},src->size);
-            Vec2i srcPosI3  = vec2iClamp((Vec2i) {srcPosF1.x,srcPosF3.y},(Vec2i){0,0},src->size);
-            Vec2i srcPosI4  = vec2iClamp((Vec2i) {srcPosF1.x,srcPosF4.y},(Vec2i){0,0},src->size);
-            Vec2i srcPosI5  = vec2iClamp((Vec2i) {srcPosF2.x,srcPosF1.y},(Vec2i){0,0},src->size);
-            Vec2i srcPosI6  = vec2iClamp((Vec2i) {srcPosF2.x,srcPosF2.y},(Vec2i){0,0},src->size);
-            Vec2i srcPosI7  = vec2iClamp((Vec2i) {srcPosF2.x,srcPosF3.y},(Vec2i){0,0},src->size);
-            Vec2i srcPosI8  = vec2iClamp((Vec2i) {srcPosF2.x,srcPosF4.y},(Vec2i){0,0},src->size);
-            Vec2i srcPosI9  = vec2iClamp((Vec2i) {srcPosF3.x,srcPosF1.y},(Vec2i){0,0},src->size);
-            Vec2i srcPosI0  = vec2iClamp((Vec2i) {srcPosF3.x,srcPosF2.y},(Vec2i){0,0},src->size);
-            Vec2i srcPosI11 = vec2iClamp((Vec2i) {srcPosF3.x,srcPosF3.y},(Vec2i){0,0},src->size);
-            Vec2i srcPosI12 = vec2iClamp((Vec2i) {srcPosF3.x,srcPosF4.y},(Vec2i){0,0},src->size);
-            Vec2i srcPosI13 = vec2iClamp((Vec2i) {srcPosF4.x,srcPosF1.y},(Vec2i){0,0},src->size);
-            Vec2i srcPosI14 = vec2iClamp((Vec2i) {srcPosF4.x,srcPosF2.y},(Vec2i){0,0},src->size);
-            Vec2i srcPosI15 = vec2iClamp((Vec2i) {srcPosF4.x,srcPosF3.y},(Vec2i){0,0},src->size);
-            Vec2i srcPosI16 = vec2iClamp((Vec2i) {srcPosF4.x,srcPosF4.y},(Vec2i){0,0},src->size);
-
-            float p1 = src->frameBuffer[(int)(srcPosI1.x + srcPosI1.y * src->size.x)].g;
-            float p2 = src->frameBuffer[(int)(srcPosI2.x + srcPosI2.y * src->size.x)].g;
-            float p3 = src->frameBuffer[(int)(srcPosI3.x + srcPosI3.y * src->size.x)].g;
-            float p4 = src->frameBuffer[(int)(srcPosI4.x + srcPosI4.y * src->size.x)].g;
-            float p5 = src->frameBuffer[(int)(srcPosI5.x + srcPosI5.y * src->size.x)].g;
-            float p6 = src->frameBuffer[(int)(srcPosI6.x + srcPosI6.y * src->size.x)].g;
-            float p7 = src->frameBuffer[(int)(srcPosI7.x + srcPosI7.y * src->size.x)].g;
-            float p8 = src->frameBuffer[(int)(srcPosI8.x + srcPosI8.y * src->size.x)].g;
-            float p9 = src->frameBuffer[(int)(srcPosI9.x + srcPosI9.y * src->size.x)].g;
-            float p0 = src->frameBuffer[(int)(srcPosI0.x + srcPosI0.y * src->size.x)].g;
-            float p11 = src->frameBuffer[(int)(srcPosI11.x + srcPosI11.y * src->size.x)].g;
-            float p12 = src->frameBuffer[(int)(srcPosI12.x + srcPosI12.y * src->size.x)].g;
-            float p13 = src->frameBuffer[(int)(srcPosI13.x + srcPosI13.y * src->size.x)].g;
-            float p14 = src->frameBuffer[(int)(srcPosI14.x + srcPosI14.y * src->size.x)].g;
-            float p15 = src->frameBuffer[(int)(srcPosI15.x + srcPosI15.y * src->size.x)].g;
-            float p16 = src->frameBuffer[(int)(srcPosI16.x + srcPosI16.y * src->size.x)].g;
-
-            Pixel color = pixelFromUInt8((p1+p2+p3+p4+p5+p6+p7+p8+p9+p0+p11+p12+p13+p14+p15+p16) / 16);
-#endif
+            //Sprite space is in texels already
+            Pixel color = sampler_read(sampler, (int32_t)(srcPosF.x * SAMPLER_ONE),
+                                       (int32_t)(srcPosF.y * SAMPLER_ONE));
             texture_draw(&des, desPos, color);
         }
     }
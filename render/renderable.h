@@ -1,10 +1,14 @@
 #pragma once
 
 #include "math/mat4.h"
+#include "bounds.h"
 
 typedef struct Renderer Renderer;
 
 /// A basic type which provide a render function pointer
 typedef struct {
   int (*render)(void *this, Mat4 transform, Renderer *renderer);
+  // Bounding sphere in the space the renderable is drawn in, can be 0 when
+  // the renderable has no bounds
+  Sphere (*bounds)(void *this);
 } Renderable;
@@ -6,12 +6,32 @@
 #include "pixel.h"
 #include "depth.h"
 #include "backend.h"
+#include "clear.h"
+#include "damage.h"
+#include "occlusion.h"
+#include "queue.h"
+#include "tiler.h"
+#include "triangle.h"
+#include "visibility.h"
 
 int renderer_init(Renderer * r, Vec2i size, Backend * backend) {
     r->root_renderable = 0;
     r->clear = 1;
     r->clear_color = PIXELBLACK;
     r->backend = backend;
+    r->depth_format = DEPTH_32;
+    r->hiz = 0;
+    r->clear_blocks = 0;
+    r->damage = 0;
+    r->vertex_cache = 0;
+    r->vertex_cache_size = 0;
+    r->tiler = 0;
+    r->visibility = 0;
+    r->queue = 0;
+    r->occlusion = 0;
+    r->face_order = 0;
+    r->face_buckets = 0;
+    r->face_sort_size = 0;
     r->backend->init(r, r->backend, (Vec4i) { 0, 0, 0, 0 });
 
     int e = 0;
@@ -28,7 +48,19 @@ int renderer_render(Renderer *r)
     Backend *be = r->backend;
 
     int pixels = r->framebuffer.size.x * r->framebuffer.size.y;
-    memset(be->getZetaBuffer(r,be), 0, pixels * sizeof (PingoDepth));
+    if (r->clear_blocks != 0)
+        clear_begin(r);
+    else if (r->damage == 0)
+        memset(be->getZetaBuffer(r,be), 0, pixels * depth_format_size(r->depth_format));
+    if (r->hiz != 0) {
+        int tiles = DEPTH_HIZ_SIZE(r->framebuffer.size.x, r->framebuffer.size.y);
+        memset(r->hiz, 0, tiles * sizeof (PingoDepth));
+    }
+    if (r->visibility != 0)
+        visibility_clear(r->visibility, r);
+
+    r->view = mat4Inverse(&r->camera_view);
+    r->frustum = frustum_from_projection(&r->camera_projection);
 
     be->beforeRender(r, be);
 
@@ -36,12 +68,34 @@ int renderer_render(Renderer *r)
     r->framebuffer.frameBuffer = be->getFrameBuffer(r, be);
 
     //Clear draw buffer before rendering
-    if (r->clear) {
+    if (r->damage != 0)
+        damage_begin(r->damage, r);
+    else if (r->clear && r->clear_blocks == 0) {
         memset(be->getFrameBuffer(r,be), 0, pixels * sizeof (Pixel));
     }
 
+    if (r->occlusion != 0) {
+        occlusion_clear(r->occlusion);
+        r->occlusion->rasterizing = true;
+        r->root_renderable->render(r->root_renderable, mat4Identity(), r);
+        r->occlusion->rasterizing = false;
+    }
+
     r->root_renderable->render(r->root_renderable, mat4Identity(), r);
 
+    renderer_flush(r);
+
+    if (r->clear_blocks != 0)
+        clear_end(r);
+
+    if (r->damage != 0) {
+        damage_end(r->damage);
+        if (be->afterRenderRects != 0) {
+            be->afterRenderRects(r, be, r->damage->present.rects, r->damage->present.count);
+            return 0;
+        }
+    }
+
     be->afterRender(r, be);
 
     return 0;
@@ -55,3 +109,149 @@ int renderer_set_root_renderable(Renderer *renderer, Renderable *root)
     renderer->root_renderable = root;
     return 0;
 }
+
+bool renderer_cull_sphere(Renderer *renderer, Sphere bounds, Mat4 *transform)
+{
+    Mat4 vm = mat4MultiplyM(&renderer->view, transform);
+    return frustum_cull_sphere(&renderer->frustum, sphere_transform(bounds, &vm));
+}
+
+int renderer_set_hiz(Renderer *renderer, PingoDepth *hiz)
+{
+    IF_NULL_RETURN(renderer, SET_ERROR);
+
+    renderer->hiz = hiz;
+    return 0;
+}
+
+int renderer_set_lazy_clear(Renderer *renderer, uint8_t *blocks)
+{
+    IF_NULL_RETURN(renderer, SET_ERROR);
+
+    //Nothing is known about the buffers yet, the first frame clears them
+    //all
+    if (blocks != 0) {
+        int count = DEPTH_HIZ_SIZE(renderer->framebuffer.size.x, renderer->framebuffer.size.y);
+        memset(blocks, CLEAR_DIRTY, count);
+    }
+
+    renderer->clear_blocks = blocks;
+    return 0;
+}
+
+int renderer_set_damage(Renderer *renderer, Damage *damage)
+{
+    IF_NULL_RETURN(renderer, SET_ERROR);
+
+    renderer->damage = damage;
+    return 0;
+}
+
+int renderer_set_depth_format(Renderer *renderer, DepthFormat format)
+{
+    IF_NULL_RETURN(renderer, SET_ERROR);
+
+    renderer->depth_format = format;
+    return 0;
+}
+
+int renderer_set_vertex_cache(Renderer *renderer, Vertex *cache, int size)
+{
+    IF_NULL_RETURN(renderer, SET_ERROR);
+
+    renderer->vertex_cache = cache;
+    renderer->vertex_cache_size = cache != 0 ? size : 0;
+    return 0;
+}
+
+int renderer_set_tiler(Renderer *renderer, Tiler *tiler)
+{
+    IF_NULL_RETURN(renderer, SET_ERROR);
+
+    renderer->tiler = tiler;
+    return 0;
+}
+
+int renderer_set_visibility(Renderer *renderer, Visibility *visibility)
+{
+    IF_NULL_RETURN(renderer, SET_ERROR);
+
+    renderer->visibility = visibility;
+    return 0;
+}
+
+int renderer_set_queue(Renderer *renderer, Queue *queue)
+{
+    IF_NULL_RETURN(renderer, SET_ERROR);
+
+    renderer->queue = queue;
+    return 0;
+}
+
+int renderer_set_face_sort(Renderer *renderer, uint16_t *order, uint8_t *buckets, int size)
+{
+    IF_NULL_RETURN(renderer, SET_ERROR);
+
+    if (size < 0 || size > RENDERER_FACE_SORT_MAX)
+        return SET_ERROR;
+
+    renderer->face_order = order;
+    renderer->face_buckets = buckets;
+    renderer->face_sort_size = order != 0 && buckets != 0 ? size : 0;
+    return 0;
+}
+
+int renderer_set_occlusion(Renderer *renderer, Occlusion *occlusion)
+{
+    IF_NULL_RETURN(renderer, SET_ERROR);
+
+    renderer->occlusion = occlusion;
+    return 0;
+}
+
+void renderer_touch_rect(Renderer *renderer, Vec4i rect)
+{
+    clear_rect(renderer, rect);
+    if (renderer->damage != 0)
+        damage_region_add(&renderer->damage->drawn, rect);
+}
+
+int renderer_draw_triangle(Renderer *renderer, const Triangle *t)
+{
+    if (renderer->damage != 0)
+        damage_region_add(&renderer->damage->drawn, t->bounds);
+
+    Triangle stored;
+    if (renderer->visibility != 0) {
+        stored = *t;
+        stored.id = visibility_add_triangle(renderer->visibility, t);
+        if (stored.id == VISIBILITY_EMPTY) {
+            //Table full, shade what is already there and start over
+            renderer_flush(renderer);
+            stored.id = visibility_add_triangle(renderer->visibility, t);
+        }
+        t = &stored;
+    }
+
+    if (renderer->tiler != 0)
+        return tiler_add_triangle(renderer->tiler, renderer, t);
+
+    triangle_rasterize(renderer, t, (Vec4i){0, 0, renderer->framebuffer.size.x, renderer->framebuffer.size.y});
+    return 0;
+}
+
+int renderer_flush(Renderer *renderer)
+{
+    IF_NULL_RETURN(renderer, RENDER_ERROR);
+
+    if (renderer->queue != 0)
+        queue_flush(renderer->queue, renderer);
+
+    if (renderer->tiler != 0)
+        tiler_flush(renderer->tiler, renderer);
+
+    if (renderer->visibility != 0)
+        visibility_resolve(renderer->visibility, renderer);
+
+    return 0;
+}
@@ -1,10 +1,22 @@
 #pragma once
 
+#include "bounds.h"
+#include "depth.h"
 #include "pixel.h"
 #include "texture.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 typedef struct Backend Backend;
+typedef struct Damage Damage;
+typedef struct Occlusion Occlusion;
+typedef struct Queue Queue;
+typedef struct Tiler Tiler;
+typedef struct Triangle Triangle;
+typedef struct Vertex Vertex;
+typedef struct Visibility Visibility;
+
+#define RENDERER_FACE_SORT_MAX (UINT16_MAX + 1)
 
 typedef struct Renderer {
   Renderable *root_renderable;
@@ -16,8 +28,47 @@ typedef struct Renderer {
   Mat4 camera_projection;
   Mat4 camera_view;
 
+  // Derived from the camera by renderer_render: the inverse of camera_view,
+  // and the view space frustum of camera_projection
+  Mat4 view;
+  Frustum frustum;
+
   Backend *backend;
 
+  // Format of the backend depth buffer, DEPTH_32 by default
+  DepthFormat depth_format;
+
+  // Coarse depth buffer of DEPTH_HIZ_SIZE elements, optional
+  PingoDepth *hiz;
+
+  // Lazy clear state of DEPTH_HIZ_SIZE elements, optional, see clear.h
+  uint8_t *clear_blocks;
+
+  // When set only the drawn rectangles are cleared and presented
+  Damage *damage;
+
+  // Scratch buffer for the transformed positions of the mesh being drawn
+  Vertex *vertex_cache;
+  int vertex_cache_size;
+
+  // When set triangles are binned and rasterized per screen tile
+  Tiler *tiler;
+
+  // When set only triangle ids are rasterized, shading happens on flush
+  Visibility *visibility;
+
+  // When set objects are drawn nearest first on flush
+  Queue *queue;
+
+  // When set occluders are rasterized first and hidden entities skipped
+  Occlusion *occlusion;
+
+  // Scratch buffers to draw the faces of a mesh nearest first, optional.
+  // Only used together with the vertex cache
+  uint16_t *face_order;
+  uint8_t *face_buckets;
+  int face_sort_size;
+
 } Renderer;
 
 extern int renderer_render(Renderer *);
@@ -25,3 +76,47 @@ extern int renderer_render(Renderer *);
 extern int renderer_init(Renderer *, Vec2i size, Backend *backend);
 
 extern int renderer_set_root_renderable(Renderer *renderer, Renderable *root);
+
+// True when a sphere, in the space transform maps to the world, is entirely
+// outside the camera frustum
+extern bool renderer_cull_sphere(Renderer *renderer, Sphere bounds, Mat4 *transform);
+
+extern int renderer_set_hiz(Renderer *renderer, PingoDepth *hiz);
+
+// Replaces the clear of the whole depth and color buffers at the start of
+// each frame by a clear of the blocks drawn into, see clear.h. blocks holds
+// DEPTH_HIZ_SIZE elements. The backend must return the same buffers every
+// frame
+extern int renderer_set_lazy_clear(Renderer *renderer, uint8_t *blocks);
+
+extern int renderer_set_damage(Renderer *renderer, Damage *damage);
+
+// The depth buffer must hold depth_format_size(format) bytes per pixel,
+// which a PingoDepth per pixel always does
+extern int renderer_set_depth_format(Renderer *renderer, DepthFormat format);
+
+extern int renderer_set_vertex_cache(Renderer *renderer, Vertex *cache, int size);
+
+extern int renderer_set_tiler(Renderer *renderer, Tiler *tiler);
+
+extern int renderer_set_visibility(Renderer *renderer, Visibility *visibility);
+
+extern int renderer_set_queue(Renderer *renderer, Queue *queue);
+
+extern int renderer_set_occlusion(Renderer *renderer, Occlusion *occlusion);
+
+// order and buckets hold one element per face for meshes up to size faces.
+// Faces are ordered by 16 bit index, size is at most RENDERER_FACE_SORT_MAX
+extern int renderer_set_face_sort(Renderer *renderer, uint16_t *order, uint8_t *buckets, int size);
+
+// Prepares a screen rect ({minX, minY, maxX, maxY}, max excluded) for
+// drawing outside of the triangle rasterizer: clears it when lazy clear is
+// set and records it as damaged
+extern void renderer_touch_rect(Renderer *renderer, Vec4i rect);
+
+// Rasterizes a triangle, or bins it when a tiler is set
+extern int renderer_draw_triangle(Renderer *renderer, const Triangle *t);
+
+// Draws the queued objects, rasterizes every triangle still pending in the
+// tiler and resolves the visibility buffer
+extern int renderer_flush(Renderer *renderer);
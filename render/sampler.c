@@ -0,0 +1,218 @@
+#include "sampler.h"
+#include "math/fun.h"
+#include "render/state.h"
+
+#include <math.h>
+#include <stdbool.h>
+
+static inline Pixel sampler_texel(const Sampler *s, int32_t x, int32_t y)
+{
+    return texture_fetch(s->texture, x, y);
+}
+
+// Whether the texels are pixels in rows, indexed without going through
+// texture_fetch
+static inline bool sampler_linear(const Sampler *s)
+{
+    return s->texture->format == TEXTURE_PIXELS && s->texture->layout == TEXTURE_LINEAR;
+}
+
+static Pixel sampler_fetch_repeat_pow2(const Sampler *s, int32_t u, int32_t v)
+{
+    uint32_t x = (uint32_t)(u >> 16) & s->mask_x;
+    uint32_t y = (uint32_t)(v >> 16) & s->mask_y;
+    if (sampler_linear(s))
+        return s->texture->frameBuffer[x + (y << s->shift_x)];
+    return sampler_texel(s, x, y);
+}
+
+static Pixel sampler_fetch_repeat(const Sampler *s, int32_t u, int32_t v)
+{
+    Vec2i size = s->texture->size;
+    int32_t x = (u >> 16) % size.x;
+    int32_t y = (v >> 16) % size.y;
+    x += x < 0 ? size.x : 0;
+    y += y < 0 ? size.y : 0;
+    return sampler_texel(s, x, y);
+}
+
+static Pixel sampler_fetch_clamp(const Sampler *s, int32_t u, int32_t v)
+{
+    Vec2i size = s->texture->size;
+    int32_t x = u >> 16;
+    int32_t y = v >> 16;
+    x = x < 0 ? 0 : x >= size.x ? size.x - 1 : x;
+    y = y < 0 ? 0 : y >= size.y ? size.y - 1 : y;
+    return sampler_texel(s, x, y);
+}
+
+// Texel t of an axis of size texels mirrored every other repeat
+static inline int32_t sampler_mirror(int32_t t, int32_t size)
+{
+    t %= 2 * size;
+    t += t < 0 ? 2 * size : 0;
+    return t < size ? t : 2 * size - 1 - t;
+}
+
+static Pixel sampler_fetch_mirror(const Sampler *s, int32_t u, int32_t v)
+{
+    Vec2i size = s->texture->size;
+    return sampler_texel(s, sampler_mirror(u >> 16, size.x), sampler_mirror(v >> 16, size.y));
+}
+
+// Texel t of an axis of size texels
+static inline int32_t sampler_wrap(const Sampler *s, int32_t t, int32_t size)
+{
+    switch (s->wrap) {
+    case SAMPLER_CLAMP:
+        return t < 0 ? 0 : t >= size ? size - 1 : t;
+    case SAMPLER_MIRROR:
+        return sampler_mirror(t, size);
+    default:
+        t %= size;
+        return t + (t < 0 ? size : 0);
+    }
+}
+
+// Texel centers are at half coordinates: the 4 texels around u/v are those
+// around u/v moved back by half a texel, and the fraction left is the
+// weight of the right and bottom ones
+static Pixel sampler_fetch_bilinear(const Sampler *s, int32_t u, int32_t v)
+{
+    Vec2i size = s->texture->size;
+    u -= SAMPLER_ONE / 2;
+    v -= SAMPLER_ONE / 2;
+    int32_t x0 = sampler_wrap(s, u >> 16, size.x);
+    int32_t x1 = sampler_wrap(s, (u >> 16) + 1, size.x);
+    int32_t y0 = sampler_wrap(s, v >> 16, size.y);
+    int32_t y1 = sampler_wrap(s, (v >> 16) + 1, size.y);
+    return pixelBilinear(sampler_texel(s, x0, y0), sampler_texel(s, x1, y0),
+                         sampler_texel(s, x0, y1), sampler_texel(s, x1, y1),
+                         (u >> 8) & 0xFF, (v >> 8) & 0xFF);
+}
+
+static Pixel sampler_fetch_bilinear_repeat_pow2(const Sampler *s, int32_t u, int32_t v)
+{
+    u -= SAMPLER_ONE / 2;
+    v -= SAMPLER_ONE / 2;
+    uint32_t x0 = (uint32_t)(u >> 16) & s->mask_x;
+    uint32_t x1 = (x0 + 1) & s->mask_x;
+    uint32_t y0 = (uint32_t)(v >> 16) & s->mask_y;
+    uint32_t y1 = (y0 + 1) & s->mask_y;
+
+    Pixel p00, p10, p01, p11;
+    if (sampler_linear(s)) {
+        const Pixel *pixels = s->texture->frameBuffer;
+        p00 = pixels[x0 + (y0 << s->shift_x)];
+        p10 = pixels[x1 + (y0 << s->shift_x)];
+        p01 = pixels[x0 + (y1 << s->shift_x)];
+        p11 = pixels[x1 + (y1 << s->shift_x)];
+    } else {
+        p00 = sampler_texel(s, x0, y0);
+        p10 = sampler_texel(s, x1, y0);
+        p01 = sampler_texel(s, x0, y1);
+        p11 = sampler_texel(s, x1, y1);
+    }
+    return pixelBilinear(p00, p10, p01, p11, (u >> 8) & 0xFF, (v >> 8) & 0xFF);
+}
+
+// Nearest texel of a level, at texture coordinates pos
+static Pixel sampler_level_nearest(const Sampler *s, int level, Vec2f pos)
+{
+    Vec2i size = texture_level_size(s->texture, level);
+    return texture_readLevel(s->texture, level,
+                             sampler_wrap(s, (int32_t)floorf(pos.x * size.x), size.x),
+                             sampler_wrap(s, (int32_t)floorf(pos.y * size.y), size.y));
+}
+
+static Pixel sampler_level_bilinear(const Sampler *s, int level, Vec2f pos)
+{
+    Vec2i size = texture_level_size(s->texture, level);
+
+    //Texel centers are at half coordinates
+    float x = pos.x * size.x - 0.5f;
+    float y = pos.y * size.y - 0.5f;
+    float x0 = floorf(x);
+    float y0 = floorf(y);
+    uint8_t tx = (uint8_t)MIN((x - x0) * 256, 255);
+    uint8_t ty = (uint8_t)MIN((y - y0) * 256, 255);
+    int32_t ix0 = sampler_wrap(s, (int32_t)x0, size.x);
+    int32_t ix1 = sampler_wrap(s, (int32_t)x0 + 1, size.x);
+    int32_t iy0 = sampler_wrap(s, (int32_t)y0, size.y);
+    int32_t iy1 = sampler_wrap(s, (int32_t)y0 + 1, size.y);
+
+    Pixel top = pixelBlend(texture_readLevel(s->texture, level, ix0, iy0),
+                           texture_readLevel(s->texture, level, ix1, iy0), tx);
+    Pixel bottom = pixelBlend(texture_readLevel(s->texture, level, ix0, iy1),
+                              texture_readLevel(s->texture, level, ix1, iy1), tx);
+    return pixelBlend(top, bottom, ty);
+}
+
+Pixel sampler_read_lod(const Sampler *s, Vec2f pos, float lod)
+{
+    Texture *f = s->texture;
+    int last = f->mipmaps_count;
+    if (f->filter == TEXTURE_NEAREST || last == 0)
+        return sampler_level_nearest(s, 0, pos);
+
+    //Magnified, or NaN
+    if (!(lod > 0))
+        lod = 0;
+
+    if (f->filter == TEXTURE_MIPMAP_NEAREST)
+        return sampler_level_nearest(s, MIN((int)(lod + 0.5f), last), pos);
+
+    if (lod >= last)
+        return sampler_level_bilinear(s, last, pos);
+
+    int level = (int)lod;
+    uint8_t t = (uint8_t)MIN((lod - level) * 256, 255);
+    return pixelBlend(sampler_level_bilinear(s, level, pos), sampler_level_bilinear(s, level + 1, pos), t);
+}
+
+static bool sampler_pow2(int32_t size)
+{
+    return (size & (size - 1)) == 0;
+}
+
+int sampler_init(Sampler *this, Texture *texture, SamplerWrap wrap, SamplerFilter filter)
+{
+    IF_NULL_RETURN(this, INIT_ERROR);
+    IF_NULL_RETURN(texture, INIT_ERROR);
+
+    this->texture = texture;
+    this->wrap = wrap;
+    this->filter = filter;
+    this->mask_x = texture->size.x - 1;
+    this->mask_y = texture->size.y - 1;
+    this->shift_x = 0;
+    while ((1 << this->shift_x) < texture->size.x)
+        this->shift_x++;
+
+    bool pow2 = sampler_pow2(texture->size.x) && sampler_pow2(texture->size.y);
+
+    if (filter == SAMPLER_BILINEAR) {
+        if (wrap == SAMPLER_REPEAT && pow2)
+            this->fetch = &sampler_fetch_bilinear_repeat_pow2;
+        else
+            this->fetch = &sampler_fetch_bilinear;
+        return OK;
+    }
+
+    switch (wrap) {
+    case SAMPLER_CLAMP:
+        this->fetch = &sampler_fetch_clamp;
+        break;
+    case SAMPLER_MIRROR:
+        this->fetch = &sampler_fetch_mirror;
+        break;
+    default:
+        if (pow2)
+            this->fetch = &sampler_fetch_repeat_pow2;
+        else
+            this->fetch = &sampler_fetch_repeat;
+        break;
+    }
+
+    return OK;
+}
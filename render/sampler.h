@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "pixel.h"
+#include "texture.h"
+
+/**
+ * Texture sampling in fixed point.
+ *
+ * Texture coordinates are 16.16 fixed point texel units: the integer part
+ * is the texel, so the rasterizer steps them with integer adds and a fetch
+ * is a shift and a wrap. sampler_init picks the fetch for the filter, the
+ * wrap mode and the texture size: repeating a power of two texture is a
+ * mask, the other cases take a compare or a modulo.
+ *
+ * The bilinear filter blends the 4 texels around the coordinates with 8.8
+ * fixed point weights, all the channels of a pixel at once (see
+ * pixelBilinear).
+ *
+ * Coordinates must stay within +-32768 texels, sampler_fixed brings
+ * repeated and mirrored coordinates back near the texture.
+ */
+
+#define SAMPLER_ONE 65536
+
+typedef enum SamplerWrap {
+  SAMPLER_REPEAT, // Tiles the texture
+  SAMPLER_CLAMP,  // Repeats the edge texels
+  SAMPLER_MIRROR, // Tiles the texture, flipped every other time
+} SamplerWrap;
+
+typedef enum SamplerFilter {
+  SAMPLER_NEAREST,
+  SAMPLER_BILINEAR,
+} SamplerFilter;
+
+typedef struct Sampler Sampler;
+
+typedef Pixel (*SamplerFetch)(const Sampler *s, int32_t u, int32_t v);
+
+struct Sampler {
+  Texture *texture;
+  SamplerWrap wrap;
+  SamplerFilter filter;
+  SamplerFetch fetch;
+  uint32_t mask_x, mask_y; // Size - 1, for power of two sizes
+  uint32_t shift_x;        // log2 of the width, for power of two sizes
+};
+
+extern int sampler_init(Sampler *this, Texture *texture, SamplerWrap wrap, SamplerFilter filter);
+
+/// 16.16 texel coordinate of the texture coordinate t along an axis of size
+/// texels
+static inline int32_t sampler_fixed(const Sampler *s, float t, int32_t size)
+{
+  //Whole repeats do not change the texel, drop them to stay in range
+  if (s->wrap == SAMPLER_REPEAT)
+    t -= (int32_t)t;
+  else if (s->wrap == SAMPLER_MIRROR)
+    t -= (int32_t)(t * 0.5f) * 2;
+  else
+    t = t < -1.0f ? -1.0f : t > 2.0f ? 2.0f : t;
+  return (int32_t)(t * size * SAMPLER_ONE);
+}
+
+/// Samples the texture at the texture coordinates pos with its mipmap filter
+/// (see TextureFilter) at the level of detail lod. The coordinates are
+/// wrapped at every level with the wrap mode of the sampler
+extern Pixel sampler_read_lod(const Sampler *s, Vec2f pos, float lod);
+
+/// Texel at the 16.16 texel coordinates u/v
+static inline Pixel sampler_read(const Sampler *s, int32_t u, int32_t v)
+{
+  return s->fetch(s, u, v);
+}
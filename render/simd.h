@@ -0,0 +1,166 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Minimal vector layer used by the rasterizer inner loops.
+ *
+ * The instruction set is chosen at compile time from the compiler target:
+ * AVX2 (8 lanes), SSE2 or NEON (4 lanes). When none is available, or when
+ * PINGO_NO_SIMD is defined, PINGO_SIMD is left undefined and the rasterizer
+ * uses its scalar loops.
+ *
+ * Masks are VInt with every bit of a lane set when the lane is selected.
+ */
+
+#if !defined(PINGO_NO_SIMD)
+#if defined(__AVX2__)
+#define PINGO_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#define PINGO_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PINGO_SIMD_NEON
+#endif
+#endif
+
+#if defined(PINGO_SIMD_AVX2)
+#include <immintrin.h>
+
+#define PINGO_SIMD
+#define SIMD_WIDTH 8
+
+typedef __m256i VInt;
+typedef __m256 VFloat;
+
+static inline VInt vint_load(const void *p) { return _mm256_loadu_si256((const __m256i *)p); }
+static inline void vint_store(void *p, VInt a) { _mm256_storeu_si256((__m256i *)p, a); }
+static inline VInt vint_set1(int32_t a) { return _mm256_set1_epi32(a); }
+static inline VInt vint_add(VInt a, VInt b) { return _mm256_add_epi32(a, b); }
+static inline VInt vint_or(VInt a, VInt b) { return _mm256_or_si256(a, b); }
+static inline VInt vint_and(VInt a, VInt b) { return _mm256_and_si256(a, b); }
+static inline VInt vint_andnot(VInt a, VInt b) { return _mm256_andnot_si256(a, b); }
+static inline VInt vint_negative(VInt a) { return _mm256_srai_epi32(a, 31); }
+static inline VInt vint_sll(VInt a, int n) { return _mm256_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+static inline VInt vint_srl(VInt a, int n) { return _mm256_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+static inline VInt vint_cmplt_u32(VInt a, VInt b) {
+    VInt bias = _mm256_set1_epi32((int32_t)0x80000000);
+    return _mm256_cmpgt_epi32(_mm256_xor_si256(b, bias), _mm256_xor_si256(a, bias));
+}
+static inline int vint_movemask(VInt m) { return _mm256_movemask_ps(_mm256_castsi256_ps(m)); }
+
+static inline VFloat vfloat_set1(float a) { return _mm256_set1_ps(a); }
+static inline void vfloat_store(float *p, VFloat a) { _mm256_storeu_ps(p, a); }
+static inline VFloat vfloat_from_vint(VInt a) { return _mm256_cvtepi32_ps(a); }
+static inline VFloat vfloat_add(VFloat a, VFloat b) { return _mm256_add_ps(a, b); }
+static inline VFloat vfloat_sub(VFloat a, VFloat b) { return _mm256_sub_ps(a, b); }
+static inline VFloat vfloat_mul(VFloat a, VFloat b) { return _mm256_mul_ps(a, b); }
+static inline VInt vfloat_cmplt(VFloat a, VFloat b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+static inline VInt vint_from_vfloat(VFloat a) { return _mm256_cvttps_epi32(a); }
+static inline VFloat vfloat_blend(VInt m, VFloat a, VFloat b) { return _mm256_blendv_ps(b, a, _mm256_castsi256_ps(m)); }
+
+#elif defined(PINGO_SIMD_SSE2)
+#include <emmintrin.h>
+
+#define PINGO_SIMD
+#define SIMD_WIDTH 4
+
+typedef __m128i VInt;
+typedef __m128 VFloat;
+
+static inline VInt vint_load(const void *p) { return _mm_loadu_si128((const __m128i *)p); }
+static inline void vint_store(void *p, VInt a) { _mm_storeu_si128((__m128i *)p, a); }
+static inline VInt vint_set1(int32_t a) { return _mm_set1_epi32(a); }
+static inline VInt vint_add(VInt a, VInt b) { return _mm_add_epi32(a, b); }
+static inline VInt vint_or(VInt a, VInt b) { return _mm_or_si128(a, b); }
+static inline VInt vint_and(VInt a, VInt b) { return _mm_and_si128(a, b); }
+static inline VInt vint_andnot(VInt a, VInt b) { return _mm_andnot_si128(a, b); }
+static inline VInt vint_negative(VInt a) { return _mm_srai_epi32(a, 31); }
+static inline VInt vint_sll(VInt a, int n) { return _mm_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+static inline VInt vint_srl(VInt a, int n) { return _mm_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+static inline VInt vint_cmplt_u32(VInt a, VInt b) {
+    VInt bias = _mm_set1_epi32((int32_t)0x80000000);
+    return _mm_cmplt_epi32(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+}
+static inline int vint_movemask(VInt m) { return _mm_movemask_ps(_mm_castsi128_ps(m)); }
+
+static inline VFloat vfloat_set1(float a) { return _mm_set1_ps(a); }
+static inline void vfloat_store(float *p, VFloat a) { _mm_storeu_ps(p, a); }
+static inline VFloat vfloat_from_vint(VInt a) { return _mm_cvtepi32_ps(a); }
+static inline VFloat vfloat_add(VFloat a, VFloat b) { return _mm_add_ps(a, b); }
+static inline VFloat vfloat_sub(VFloat a, VFloat b) { return _mm_sub_ps(a, b); }
+static inline VFloat vfloat_mul(VFloat a, VFloat b) { return _mm_mul_ps(a, b); }
+static inline VInt vfloat_cmplt(VFloat a, VFloat b) { return _mm_castps_si128(_mm_cmplt_ps(a, b)); }
+static inline VInt vint_from_vfloat(VFloat a) { return _mm_cvttps_epi32(a); }
+static inline VFloat vfloat_blend(VInt m, VFloat a, VFloat b) {
+    __m128 mf = _mm_castsi128_ps(m);
+    return _mm_or_ps(_mm_and_ps(mf, a), _mm_andnot_ps(mf, b));
+}
+
+#elif defined(PINGO_SIMD_NEON)
+#include <arm_neon.h>
+
+#define PINGO_SIMD
+#define SIMD_WIDTH 4
+
+typedef int32x4_t VInt;
+typedef float32x4_t VFloat;
+
+static inline VInt vint_load(const void *p) { return vld1q_s32((const int32_t *)p); }
+static inline void vint_store(void *p, VInt a) { vst1q_s32((int32_t *)p, a); }
+static inline VInt vint_set1(int32_t a) { return vdupq_n_s32(a); }
+static inline VInt vint_add(VInt a, VInt b) { return vaddq_s32(a, b); }
+static inline VInt vint_or(VInt a, VInt b) { return vorrq_s32(a, b); }
+static inline VInt vint_and(VInt a, VInt b) { return vandq_s32(a, b); }
+static inline VInt vint_andnot(VInt a, VInt b) { return vbicq_s32(b, a); }
+static inline VInt vint_negative(VInt a) { return vshrq_n_s32(a, 31); }
+static inline VInt vint_sll(VInt a, int n) { return vshlq_s32(a, vdupq_n_s32(n)); }
+static inline VInt vint_srl(VInt a, int n) {
+    return vreinterpretq_s32_u32(vshlq_u32(vreinterpretq_u32_s32(a), vdupq_n_s32(-n)));
+}
+static inline VInt vint_cmplt_u32(VInt a, VInt b) {
+    return vreinterpretq_s32_u32(vcltq_u32(vreinterpretq_u32_s32(a), vreinterpretq_u32_s32(b)));
+}
+static inline int vint_movemask(VInt m) {
+    static const int32_t bits[4] = {1, 2, 4, 8};
+    int32x4_t v = vandq_s32(m, vld1q_s32(bits));
+#if defined(__aarch64__)
+    return vaddvq_s32(v);
+#else
+    int32x2_t s = vadd_s32(vget_low_s32(v), vget_high_s32(v));
+    return vget_lane_s32(vpadd_s32(s, s), 0);
+#endif
+}
+
+static inline VFloat vfloat_set1(float a) { return vdupq_n_f32(a); }
+static inline void vfloat_store(float *p, VFloat a) { vst1q_f32(p, a); }
+static inline VFloat vfloat_from_vint(VInt a) { return vcvtq_f32_s32(a); }
+static inline VFloat vfloat_add(VFloat a, VFloat b) { return vaddq_f32(a, b); }
+static inline VFloat vfloat_sub(VFloat a, VFloat b) { return vsubq_f32(a, b); }
+static inline VFloat vfloat_mul(VFloat a, VFloat b) { return vmulq_f32(a, b); }
+static inline VInt vfloat_cmplt(VFloat a, VFloat b) { return vreinterpretq_s32_u32(vcltq_f32(a, b)); }
+static inline VInt vint_from_vfloat(VFloat a) { return vcvtq_s32_f32(a); }
+static inline VFloat vfloat_blend(VInt m, VFloat a, VFloat b) { return vbslq_f32(vreinterpretq_u32_s32(m), a, b); }
+
+#endif
+
+#ifdef PINGO_SIMD
+
+/// Converts to uint32 the same way a scalar (uint32_t) cast of the float does
+/// on the target, so the vector and scalar depth paths agree bit for bit
+static inline VInt vfloat_to_u32(VFloat a)
+{
+#if defined(PINGO_SIMD_NEON)
+    return vreinterpretq_s32_u32(vcvtq_u32_f32(a));
+#else
+    // x86 converts through a 64 bit integer and keeps the low 32 bits
+    VFloat two31 = vfloat_set1(2147483648.0f);
+    VFloat two32 = vfloat_set1(4294967296.0f);
+    VInt high = vint_andnot(vfloat_cmplt(a, two31), vint_set1(-1));
+    VInt low = vfloat_cmplt(a, vfloat_sub(vfloat_set1(0), two31));
+    VFloat shifted = vfloat_blend(high, vfloat_sub(a, two32), a);
+    shifted = vfloat_blend(low, vfloat_add(a, two32), shifted);
+    return vint_from_vfloat(shifted);
+#endif
+}
+
+#endif
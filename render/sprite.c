@@ -1,6 +1,7 @@
 #include "sprite.h"
 #include "math/mat4.h"
 #include "render/rasterizer.h"
+#include "occlusion.h"
 #include "renderer.h"
 #include "state.h"
 
@@ -20,7 +21,13 @@ int render_sprite(void *_sprite, Mat4 transform, Renderer *renderer)
  *     return 0;
  * }
 */
-    rasterizer_draw_transformed(transform, renderer, &sprite->texture);
+    if (renderer->occlusion != 0 && renderer->occlusion->rasterizing)
+        return OK;
+
+    //Binned triangles submitted before the sprite must be drawn below it
+    renderer_flush(renderer);
+
+    rasterizer_draw_transformed(transform, renderer, &sprite->sampler);
     return OK;
 };
 
@@ -30,8 +37,16 @@ int sprite_init(Sprite *this, Texture texture)
 
     this->texture = texture;
     this->renderable.render = &render_sprite;
+    this->renderable.bounds = 0;
 
-  return OK;
+  return sampler_init(&this->sampler, &this->texture, SAMPLER_CLAMP, SAMPLER_NEAREST);
+}
+
+int sprite_set_filter(Sprite *this, SamplerFilter filter)
+{
+    IF_NULL_RETURN(this, SET_ERROR);
+
+    return sampler_init(&this->sampler, &this->texture, SAMPLER_CLAMP, filter);
 }
 
 int sprite_randomize(Sprite *this) {
@@ -1,12 +1,15 @@
 #pragma once
 
 #include "renderable.h"
+#include "sampler.h"
 #include "texture.h"
 
 typedef struct Sprite {
   Renderable renderable;
   Texture texture;
+  Sampler sampler; // Fetches texels of texture, nearest and clamped by default
 } Sprite;
 
 extern int sprite_init(Sprite *this, Texture texture);
+extern int sprite_set_filter(Sprite *this, SamplerFilter filter);
 extern int sprite_randomize(Sprite *this);
@@ -0,0 +1,220 @@
+#include "swapchain.h"
+#include "state.h"
+
+#include <time.h>
+
+static double swapchain_now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Presents the oldest queued frame, the queue is left untouched
+static void swapchain_present(Swapchain *this)
+{
+    Renderer *frame = &this->frames[this->first];
+    this->target->beforeRender(frame, this->target);
+    this->target->afterRender(frame, this->target);
+}
+
+// Removes the frame just presented from the queue, under the lock when
+// threaded
+static void swapchain_release(Swapchain *this)
+{
+    this->latency = swapchain_now() - this->submitted[this->first];
+    this->presented++;
+    this->first = (this->first + 1) % this->buffers_count;
+    this->queued--;
+}
+
+#ifdef PINGO_THREADS
+
+static void *swapchain_presenter(void *arg)
+{
+    Swapchain *this = arg;
+
+    pthread_mutex_lock(&this->mutex);
+    for (;;) {
+        while (this->queued == 0 && !this->quit)
+            pthread_cond_wait(&this->changed, &this->mutex);
+        if (this->queued == 0)
+            break;
+        pthread_mutex_unlock(&this->mutex);
+
+        swapchain_present(this);
+
+        pthread_mutex_lock(&this->mutex);
+        swapchain_release(this);
+        pthread_cond_broadcast(&this->changed);
+    }
+    pthread_mutex_unlock(&this->mutex);
+
+    return 0;
+}
+
+#endif
+
+static void swapchain_init_backend(Renderer *r, Backend *backend, Vec4i rect)
+{
+    Swapchain *this = (Swapchain *)backend;
+    this->target->init(r, this->target, rect);
+}
+
+static void swapchain_before_render(Renderer *r, Backend *backend)
+{
+    (void)r;
+    Swapchain *this = (Swapchain *)backend;
+    int next = (this->current + 1) % this->buffers_count;
+
+    //The next buffer is the oldest queued one when they are all queued
+#ifdef PINGO_THREADS
+    pthread_mutex_lock(&this->mutex);
+    while (this->queued == this->buffers_count)
+        pthread_cond_wait(&this->changed, &this->mutex);
+    pthread_mutex_unlock(&this->mutex);
+#endif
+
+    this->current = next;
+}
+
+static void swapchain_after_render(Renderer *r, Backend *backend)
+{
+    Swapchain *this = (Swapchain *)backend;
+    int current = this->current;
+
+    this->frames[current] = *r;
+    this->frames[current].framebuffer.frameBuffer = this->buffers[current];
+    this->submitted[current] = swapchain_now();
+
+#ifdef PINGO_THREADS
+    pthread_mutex_lock(&this->mutex);
+    this->queued++;
+    pthread_cond_broadcast(&this->changed);
+    pthread_mutex_unlock(&this->mutex);
+#else
+    this->queued++;
+    swapchain_present(this);
+    swapchain_release(this);
+#endif
+}
+
+static Pixel *swapchain_get_frame_buffer(Renderer *r, Backend *backend)
+{
+    (void)r;
+    Swapchain *this = (Swapchain *)backend;
+    return this->buffers[this->current];
+}
+
+static PingoDepth *swapchain_get_zeta_buffer(Renderer *r, Backend *backend)
+{
+    (void)r;
+    Swapchain *this = (Swapchain *)backend;
+    return this->depth;
+}
+
+int swapchain_init(Swapchain *this, Backend *target, Pixel **buffers,
+                   int buffers_count, PingoDepth *depth)
+{
+    IF_NULL_RETURN(this, INIT_ERROR);
+    IF_NULL_RETURN(target, INIT_ERROR);
+    IF_NULL_RETURN(buffers, INIT_ERROR);
+    IF_NULL_RETURN(depth, INIT_ERROR);
+
+    if (buffers_count < 1 || buffers_count > SWAPCHAIN_BUFFERS_MAX)
+        return INIT_ERROR;
+
+    this->backend.init = &swapchain_init_backend;
+    this->backend.beforeRender = &swapchain_before_render;
+    this->backend.afterRender = &swapchain_after_render;
+    this->backend.getFrameBuffer = &swapchain_get_frame_buffer;
+    this->backend.getZetaBuffer = &swapchain_get_zeta_buffer;
+    this->backend.afterRenderRects = 0;
+
+    this->target = target;
+    for (int i = 0; i < buffers_count; i++) {
+        IF_NULL_RETURN(buffers[i], INIT_ERROR);
+        this->buffers[i] = buffers[i];
+    }
+    this->buffers_count = buffers_count;
+    this->depth = depth;
+
+    //beforeRender moves to the next buffer, the first frame goes to buffer 0
+    this->current = buffers_count - 1;
+    this->first = 0;
+    this->queued = 0;
+    this->latency = 0;
+    this->presented = 0;
+
+#ifdef PINGO_THREADS
+    pthread_mutex_init(&this->mutex, 0);
+    pthread_cond_init(&this->changed, 0);
+    this->quit = false;
+    if (pthread_create(&this->thread, 0, &swapchain_presenter, this) != 0) {
+        pthread_cond_destroy(&this->changed);
+        pthread_mutex_destroy(&this->mutex);
+        return INIT_ERROR;
+    }
+#endif
+
+    return OK;
+}
+
+int swapchain_wait(Swapchain *this)
+{
+    IF_NULL_RETURN(this, RENDER_ERROR);
+
+#ifdef PINGO_THREADS
+    pthread_mutex_lock(&this->mutex);
+    while (this->queued > 0)
+        pthread_cond_wait(&this->changed, &this->mutex);
+    pthread_mutex_unlock(&this->mutex);
+#endif
+
+    return OK;
+}
+
+int swapchain_destroy(Swapchain *this)
+{
+    IF_NULL_RETURN(this, SET_ERROR);
+
+#ifdef PINGO_THREADS
+    pthread_mutex_lock(&this->mutex);
+    this->quit = true;
+    pthread_cond_broadcast(&this->changed);
+    pthread_mutex_unlock(&this->mutex);
+
+    pthread_join(this->thread, 0);
+
+    pthread_cond_destroy(&this->changed);
+    pthread_mutex_destroy(&this->mutex);
+#endif
+
+    return OK;
+}
+
+double swapchain_latency(Swapchain *this)
+{
+    double latency;
+#ifdef PINGO_THREADS
+    pthread_mutex_lock(&this->mutex);
+    latency = this->latency;
+    pthread_mutex_unlock(&this->mutex);
+#else
+    latency = this->latency;
+#endif
+    return latency;
+}
+
+int swapchain_queued(Swapchain *this)
+{
+    int queued;
+#ifdef PINGO_THREADS
+    pthread_mutex_lock(&this->mutex);
+    queued = this->queued;
+    pthread_mutex_unlock(&this->mutex);
+#else
+    queued = this->queued;
+#endif
+    return queued;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "backend.h"
+#include "renderer.h"
+
+#ifdef PINGO_THREADS
+#include <pthread.h>
+#endif
+
+/**
+ * Asynchronous present.
+ *
+ * A swapchain is a backend wrapping the target backend that actually
+ * presents. It hands the renderer one of buffers_count color buffers in
+ * turn, and queues each finished frame to a present thread instead of
+ * presenting it on the spot: frame N + 1 rasterizes while frame N is being
+ * presented. When every buffer is queued, the renderer waits for the oldest
+ * to be presented before starting the next frame, so the queue never holds
+ * more than buffers_count frames.
+ *
+ * The depth buffer is only read while rasterizing, a single one is shared
+ * by every frame. The target afterRender must present
+ * ren->framebuffer.frameBuffer; its beforeRender and afterRender are both
+ * called by the present thread, one after the other. Since the buffers
+ * change every frame, the lazy clear and the damage tracking cannot be used
+ * together with a swapchain.
+ *
+ * Without PINGO_THREADS frames are presented as soon as they are rendered.
+ */
+
+#define SWAPCHAIN_BUFFERS_MAX 4
+
+typedef struct Swapchain {
+  Backend backend; // Given to the renderer
+  Backend *target; // Presents the frames
+
+  Pixel *buffers[SWAPCHAIN_BUFFERS_MAX];
+  int buffers_count;
+  PingoDepth *depth;
+
+  int current; // Buffer being rendered
+  int first;   // Oldest queued buffer
+  int queued;  // Frames waiting for or being presented
+
+  // State of the renderer when each queued frame was submitted
+  Renderer frames[SWAPCHAIN_BUFFERS_MAX];
+  double submitted[SWAPCHAIN_BUFFERS_MAX];
+
+  double latency;     // Seconds from submit to the end of present, last frame
+  uint64_t presented; // Frames presented so far
+
+#ifdef PINGO_THREADS
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t changed;
+  bool quit;
+#endif
+} Swapchain;
+
+/// buffers holds buffers_count color buffers, from 1 to SWAPCHAIN_BUFFERS_MAX,
+/// of the size of the screen. depth is the depth buffer. The renderer must
+/// be initialized with &this->backend
+extern int swapchain_init(Swapchain *this, Backend *target, Pixel **buffers,
+                          int buffers_count, PingoDepth *depth);
+
+/// Waits until every queued frame is presented
+extern int swapchain_wait(Swapchain *this);
+
+/// Presents the queued frames and stops the present thread
+extern int swapchain_destroy(Swapchain *this);
+
+/// Seconds between the end of the rasterization of the last presented frame
+/// and the end of its present
+extern double swapchain_latency(Swapchain *this);
+
+/// Frames rendered but not presented yet
+extern int swapchain_queued(Swapchain *this);
@@ -1,5 +1,9 @@
 #include "texture.h"
+#include "math/fun.h"
 #include "render/state.h"
+#include "texture_cache.h"
+#include "virtual_texture.h"
+#include <math.h>
 #include <stdio.h>
 
 int texture_init( Texture *f, Vec2i size, Pixel *buf )
@@ -12,30 +16,235 @@ int texture_init( Texture *f, Vec2i size, Pixel *buf )
 
     f->frameBuffer = (Pixel *)buf;
     f->size = size;
+    f->format = TEXTURE_PIXELS;
+    f->texels = 0;
+    f->palette = 0;
+    f->cache = 0;
+    f->virtual_texture = 0;
+    f->file = 0;
+    f->file_size = 0;
+    f->mipmaps_count = 0;
+    f->filter = TEXTURE_NEAREST;
+    f->layout = TEXTURE_LINEAR;
 
     return OK;
 }
 
+int texture_init_compressed(Texture *f, Vec2i size, TextureFormat format,
+                            const uint8_t *texels, const Pixel *palette)
+{
+    IF_NULL_RETURN(f, INIT_ERROR);
+    IF_NULL_RETURN(texels, INIT_ERROR);
+
+    if (size.x * size.y == 0 || format == TEXTURE_PIXELS || format == TEXTURE_VIRTUAL)
+        return INIT_ERROR;
+    if (format != TEXTURE_BC1 && palette == 0)
+        return INIT_ERROR;
+
+    f->frameBuffer = 0;
+    f->size = size;
+    f->format = format;
+    f->texels = texels;
+    f->palette = palette;
+    f->cache = 0;
+    f->virtual_texture = 0;
+    f->file = 0;
+    f->file_size = 0;
+    f->mipmaps_count = 0;
+    f->filter = TEXTURE_NEAREST;
+    f->layout = TEXTURE_LINEAR;
+
+    return OK;
+}
+
+int texture_set_cache(Texture *f, TextureCache *cache)
+{
+    IF_NULL_RETURN(f, SET_ERROR);
+
+    if (cache != 0 && f->format != TEXTURE_BC1)
+        return SET_ERROR;
+
+    f->cache = cache;
+    if (cache != 0)
+        texture_cache_clear(cache);
+    return OK;
+}
+
+static inline Pixel texture_rgb565(uint32_t c)
+{
+    uint32_t r = (c >> 11) & 0x1F;
+    uint32_t g = (c >> 5) & 0x3F;
+    uint32_t b = c & 0x1F;
+    return pixelFromRGBA((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255);
+}
+
+// The 4 colors the texels of a BC1 block pick from
+static void texture_bc1_colors(const uint8_t *block, Pixel colors[4])
+{
+    uint32_t c0 = block[0] | block[1] << 8;
+    uint32_t c1 = block[2] | block[3] << 8;
+    colors[0] = texture_rgb565(c0);
+    colors[1] = texture_rgb565(c1);
+    if (c0 > c1) {
+        colors[2] = pixelBlend(colors[0], colors[1], 85);
+        colors[3] = pixelBlend(colors[0], colors[1], 171);
+    } else {
+        colors[2] = pixelBlend(colors[0], colors[1], 128);
+        colors[3] = pixelFromRGBA(0, 0, 0, 0);
+    }
+}
+
+static inline uint32_t texture_bc1_block(const Texture *f, int32_t x, int32_t y)
+{
+    return (x >> 2) + (y >> 2) * ((f->size.x + 3) >> 2);
+}
+
+static Pixel texture_decode_bc1(const Texture *f, int32_t x, int32_t y)
+{
+    uint32_t index = texture_bc1_block(f, x, y);
+    int texel = (x & 3) + (y & 3) * 4;
+
+    Pixel value;
+    if (f->cache != 0 && texture_cache_lookup(f->cache, index, texel, &value))
+        return value;
+
+    const uint8_t *block = &f->texels[index * 8];
+    uint32_t bits = block[4] | block[5] << 8 | block[6] << 16 | (uint32_t)block[7] << 24;
+    Pixel colors[4];
+    texture_bc1_colors(block, colors);
+    if (f->cache == 0)
+        return colors[(bits >> (texel * 2)) & 3];
+
+    Pixel texels[TEXTURE_CACHE_TEXELS];
+    for (int i = 0; i < TEXTURE_CACHE_TEXELS; i++)
+        texels[i] = colors[(bits >> (i * 2)) & 3];
+    texture_cache_store(f->cache, index, texels);
+    return texels[texel];
+}
+
+Pixel texture_decode(const Texture *f, int32_t x, int32_t y)
+{
+    switch (f->format) {
+    case TEXTURE_PALETTE8:
+        return f->palette[f->texels[x + y * f->size.x]];
+    case TEXTURE_PALETTE4: {
+        uint8_t pair = f->texels[(x >> 1) + y * ((f->size.x + 1) >> 1)];
+        return f->palette[(pair >> ((x & 1) * 4)) & 0xF];
+    }
+    case TEXTURE_BC1:
+        return texture_decode_bc1(f, x, y);
+    case TEXTURE_VIRTUAL:
+        return virtual_texture_fetch(f->virtual_texture, 0, x, y);
+    default:
+        return f->frameBuffer[texture_index(f, f->size, x, y)];
+    }
+}
+
+// Pixels taken by a level of the given size
+static inline uint32_t texture_level_pixels(const Texture *f, Vec2i size)
+{
+    if (f->layout == TEXTURE_LINEAR)
+        return size.x * size.y;
+    return TEXTURE_TILED_SIZE(size.x, size.y);
+}
+
 
 void texture_draw(Texture *f, Vec2i pos, Pixel color)
 {
-    f->frameBuffer[pos.x + pos.y * f->size.x] = color;
+    f->frameBuffer[texture_index(f, f->size, pos.x, pos.y)] = color;
 }
 
 Pixel texture_read(Texture *f, Vec2i pos)
 {
-    return f->frameBuffer[pos.x + pos.y * f->size.x];
+    return texture_fetch(f, pos.x, pos.y);
 }
 
 Pixel texture_readF(Texture *f, Vec2f pos)
 {
-    uint16_t x = (uint16_t)(pos.x * f->size.x) % f->size.x;
-    uint16_t y = (uint16_t)(pos.y * f->size.y) % f->size.x;
-    uint32_t index = x + y * f->size.x;
-    Pixel value = f->frameBuffer[index];
-    return value;
+    int32_t x = (int32_t)floorf(pos.x * f->size.x) % f->size.x;
+    int32_t y = (int32_t)floorf(pos.y * f->size.y) % f->size.y;
+    x += x < 0 ? f->size.x : 0;
+    y += y < 0 ? f->size.y : 0;
+    return texture_fetch(f, x, y);
 }
 
+// Texel x/y of a level of the given size, the base level in any format
+static inline Pixel texture_level_texel(const Texture *f, int level, Vec2i size, int32_t x, int32_t y)
+{
+    if (f->format == TEXTURE_VIRTUAL)
+        return virtual_texture_fetch(f->virtual_texture, level, x, y);
+    if (level == 0)
+        return texture_fetch(f, x, y);
+    return f->mipmaps[level - 1][texture_index(f, size, x, y)];
+}
 
+int texture_build_mipmaps(Texture *f, Pixel *pixels)
+{
+    IF_NULL_RETURN(f, INIT_ERROR);
+    IF_NULL_RETURN(pixels, INIT_ERROR);
+
+    //Virtual textures come with their levels
+    if (f->format == TEXTURE_VIRTUAL)
+        return INIT_ERROR;
+
+    f->mipmaps_count = 0;
+    Vec2i size = f->size;
+    while ((size.x > 1 || size.y > 1) && f->mipmaps_count < TEXTURE_MIPMAPS_MAX) {
+        int src = f->mipmaps_count;
+        Vec2i dstSize = texture_level_size(f, f->mipmaps_count + 1);
+
+        //Odd sizes repeat their last row or column
+        for (int32_t y = 0; y < dstSize.y; y++) {
+            int32_t y0 = y * 2;
+            int32_t y1 = MIN(y * 2 + 1, size.y - 1);
+            for (int32_t x = 0; x < dstSize.x; x++) {
+                int32_t x0 = x * 2;
+                int32_t x1 = MIN(x * 2 + 1, size.x - 1);
+                Pixel top = pixelBlend(texture_level_texel(f, src, size, x0, y0),
+                                       texture_level_texel(f, src, size, x1, y0), 128);
+                Pixel bottom = pixelBlend(texture_level_texel(f, src, size, x0, y1),
+                                          texture_level_texel(f, src, size, x1, y1), 128);
+                pixels[texture_index(f, dstSize, x, y)] = pixelBlend(top, bottom, 128);
+            }
+        }
 
+        f->mipmaps[f->mipmaps_count++] = pixels;
+        pixels += texture_level_pixels(f, dstSize);
+        size = dstSize;
+    }
+
+    return OK;
+}
 
+int texture_tile(Texture *f, Pixel *tiled)
+{
+    IF_NULL_RETURN(f, INIT_ERROR);
+    IF_NULL_RETURN(tiled, INIT_ERROR);
+
+    if (f->format != TEXTURE_PIXELS)
+        return INIT_ERROR;
+
+    Texture linear = *f;
+    f->layout = TEXTURE_TILED;
+    for (int32_t y = 0; y < f->size.y; y++) {
+        for (int32_t x = 0; x < f->size.x; x++)
+            tiled[texture_index(f, f->size, x, y)] = linear.frameBuffer[texture_index(&linear, f->size, x, y)];
+    }
+
+    f->frameBuffer = tiled;
+    f->mipmaps_count = 0;
+    return OK;
+}
+
+int texture_set_filter(Texture *f, TextureFilter filter)
+{
+    IF_NULL_RETURN(f, SET_ERROR);
+
+    f->filter = filter;
+    return OK;
+}
+
+Pixel texture_readLevel(Texture *f, int level, int32_t x, int32_t y)
+{
+    return texture_level_texel(f, level, texture_level_size(f, level), x, y);
+}
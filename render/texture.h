@@ -4,15 +4,178 @@
 #include "pixel.h"
 #include "renderable.h"
 
+/**
+ * Mipmaps.
+ *
+ * texture_build_mipmaps halves the texture again and again down to 1x1, each
+ * level averaging 2x2 texels of the previous one. A minified texture is then
+ * sampled from the level whose texels are about the size of a screen pixel:
+ * the texels read by neighbouring pixels are neighbours in memory and the
+ * small levels stay in cache, where sampling the base level reads texels
+ * far apart and aliases.
+ *
+ * The level of detail is log2 of the texels a screen pixel spans on the
+ * base level, the rasterizer derives it from the texture coordinates
+ * derivatives.
+ */
+
+#define TEXTURE_MIPMAPS_MAX 15
+
+// Pixels needed for the mipmaps of a width x height texture, in any layout
+#define TEXTURE_MIPMAPS_SIZE(width, height)                                    \
+  ((width) * (height) / 3 + 4 * ((width) + (height)) + 16 * TEXTURE_MIPMAPS_MAX)
+
+/**
+ * Texel layouts.
+ *
+ * TEXTURE_LINEAR stores rows one after the other: texels above and below
+ * each other are a row apart, and a walk down the texture misses the cache
+ * on every fetch. TEXTURE_TILED stores 4x4 tiles, each one a single 64
+ * bytes cache line of 32 bit pixels, so the texels around a fetch are
+ * likely cached whatever the direction of the walk. Sizes that are not
+ * multiples of 4 are padded to whole tiles.
+ */
+
+#define TEXTURE_TILE 4
+
+// Pixels of a width x height texture in the tiled layout
+#define TEXTURE_TILED_SIZE(width, height)                                      \
+  ((((width) + TEXTURE_TILE - 1) / TEXTURE_TILE) *                             \
+   (((height) + TEXTURE_TILE - 1) / TEXTURE_TILE) * TEXTURE_TILE * TEXTURE_TILE)
+
+typedef enum TextureLayout {
+  TEXTURE_LINEAR,
+  TEXTURE_TILED,
+} TextureLayout;
+
+typedef enum TextureFilter {
+  TEXTURE_NEAREST,         // Nearest texel of the base level
+  TEXTURE_MIPMAP_NEAREST,  // Nearest texel of the nearest level
+  TEXTURE_TRILINEAR,       // Bilinear in the two nearest levels, blended
+} TextureFilter;
+
+/**
+ * Compressed formats.
+ *
+ * A compressed texture keeps its texels in a smaller format and decodes them
+ * on fetch, frameBuffer is unused and the texture cannot be drawn to:
+ *  - TEXTURE_PALETTE8 stores a byte per texel, indexing a palette of 256
+ *    pixels, row after row;
+ *  - TEXTURE_PALETTE4 stores 4 bits per texel, indexing a palette of 16
+ *    pixels, the left texel in the low bits of each byte. Rows start on a
+ *    byte;
+ *  - TEXTURE_BC1 stores 4x4 blocks of 8 bytes, row after row: two RGB565 end
+ *    point colors, little endian, followed by 2 bits per texel, texels in
+ *    rows, the first in the low bits. When the first color is the larger the
+ *    texels pick one of the end points or one of the two colors between
+ *    them, otherwise one of the end points, their average or transparent
+ *    black.
+ *
+ * A BC1 texture may be given a TextureCache of decoded blocks.
+ */
+
+// Bytes taken by the texels of a width x height texture in a compressed
+// format
+#define TEXTURE_PALETTE8_SIZE(width, height) ((width) * (height))
+#define TEXTURE_PALETTE4_SIZE(width, height) ((((width) + 1) / 2) * (height))
+#define TEXTURE_BC1_SIZE(width, height)                                        \
+  ((((width) + 3) / 4) * (((height) + 3) / 4) * 8)
+
+typedef enum TextureFormat {
+  TEXTURE_PIXELS,   // Pixels in frameBuffer
+  TEXTURE_PALETTE8,
+  TEXTURE_PALETTE4,
+  TEXTURE_BC1,
+  TEXTURE_VIRTUAL,  // Pages streamed by a VirtualTexture
+} TextureFormat;
+
+struct TextureCache;
+struct VirtualTexture;
+
 typedef struct Texture {
   Vec2i size;
   Pixel *frameBuffer;
+
+  // TEXTURE_PIXELS unless initialized with texture_init_compressed
+  TextureFormat format;
+  const uint8_t *texels;      // Compressed texels
+  const Pixel *palette;       // Of the palettized formats
+  struct TextureCache *cache; // Decoded BC1 blocks, optional
+  struct VirtualTexture *virtual_texture; // Of TEXTURE_VIRTUAL textures
+
+  // Levels 1 and up, level 0 being frameBuffer
+  Pixel *mipmaps[TEXTURE_MIPMAPS_MAX];
+  int mipmaps_count;
+
+  // Used by sampler_read_lod, TEXTURE_NEAREST by default
+  TextureFilter filter;
+
+  // Of every level, TEXTURE_LINEAR by default
+  TextureLayout layout;
+
+  // Memory holding the texels when loaded from a file, see texture_unload
+  void *file;
+  size_t file_size;
 } Texture;
 
+// Offset of the texel x/y in a level of the given size
+static inline uint32_t texture_index(const Texture *f, Vec2i size, int32_t x, int32_t y)
+{
+  if (f->layout == TEXTURE_LINEAR)
+    return x + y * size.x;
+
+  uint32_t ux = x, uy = y;
+  uint32_t tiles = (size.x + TEXTURE_TILE - 1) / TEXTURE_TILE;
+  uint32_t tile = (ux / TEXTURE_TILE) + (uy / TEXTURE_TILE) * tiles;
+  return tile * TEXTURE_TILE * TEXTURE_TILE + (uy % TEXTURE_TILE) * TEXTURE_TILE + ux % TEXTURE_TILE;
+}
+
+/// Decodes the texel x/y of a compressed texture
+extern Pixel texture_decode(const Texture *f, int32_t x, int32_t y);
+
+/// Texel x/y of the base level, in any format
+static inline Pixel texture_fetch(const Texture *f, int32_t x, int32_t y)
+{
+  if (f->format == TEXTURE_PIXELS)
+    return f->frameBuffer[texture_index(f, f->size, x, y)];
+  return texture_decode(f, x, y);
+}
+
 extern int texture_init(Texture *f, Vec2i size, Pixel *);
 
+/// texels holds the texels in format, palette the palette of the palettized
+/// formats. Both must outlive the texture
+extern int texture_init_compressed(Texture *f, Vec2i size, TextureFormat format,
+                                   const uint8_t *texels, const Pixel *palette);
+
+/// Caches the decoded blocks of a BC1 texture in cache, 0 to decode every
+/// fetch. The cache must not be shared with another texture
+extern int texture_set_cache(Texture *f, struct TextureCache *cache);
+
+/**
+ * Texture files.
+ *
+ * The loaders map the file in memory instead of reading it. When its texels
+ * are already pixels in the order of the texture they are used in place, the
+ * file is never copied. Otherwise a 32 bit file is converted in place, in a
+ * private copy on write mapping, swapping red and blue 4 to 8 pixels at a
+ * time (see render/simd.h), and other files are converted in one pass to
+ * new memory.
+ *
+ * Row 0 of a texture is the bottom of the image: the rows of files stored
+ * top down are flipped during the conversion.
+ */
+
+/// Loads a raw file of size.x * size.y RGBA texels, top row first
 extern int texture_init_rgbafile(Texture *f, Vec2i size, char *filename);
 
+/// Loads an uncompressed 24 or 32 bit TGA file, or a binary PPM (P6) file
+/// with 255 as the maximum value
+extern int texture_init_file(Texture *f, const char *filename);
+
+/// Releases the memory of a texture initialized by a loader
+extern int texture_unload(Texture *f);
+
 extern Renderable texture_as_renderable(Texture *s);
 
 extern void texture_draw(Texture *f, Vec2i pos, Pixel color);
@@ -20,3 +183,26 @@ extern void texture_draw(Texture *f, Vec2i pos, Pixel color);
 extern Pixel texture_read(Texture *f, Vec2i pos);
 
 extern Pixel texture_readF(Texture *f, Vec2f pos);
+
+/// Copies the texels to tiled, which must hold TEXTURE_TILED_SIZE elements,
+/// in the tiled layout and uses it from then on. Mipmaps are dropped, build
+/// them afterwards to have them tiled as well. Compressed textures cannot be
+/// tiled
+extern int texture_tile(Texture *f, Pixel *tiled);
+
+/// Builds the mipmaps into pixels, which must hold TEXTURE_MIPMAPS_SIZE
+/// elements. Has to be called again when the base level changes. The
+/// mipmaps of compressed textures are pixels
+extern int texture_build_mipmaps(Texture *f, Pixel *pixels);
+
+extern int texture_set_filter(Texture *f, TextureFilter filter);
+
+/// Size of a level, level 0 being the base one
+static inline Vec2i texture_level_size(const Texture *f, int level)
+{
+  int32_t x = f->size.x >> level, y = f->size.y >> level;
+  return (Vec2i){x > 0 ? x : 1, y > 0 ? y : 1};
+}
+
+/// Texel x/y of a level, within its size, in any format
+extern Pixel texture_readLevel(Texture *f, int level, int32_t x, int32_t y);
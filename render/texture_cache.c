@@ -0,0 +1,56 @@
+#include "texture_cache.h"
+#include "render/state.h"
+
+#include <string.h>
+
+int texture_cache_init(TextureCache *this, TextureCacheLine *lines, uint32_t lines_count)
+{
+    IF_NULL_RETURN(this, INIT_ERROR);
+    IF_NULL_RETURN(lines, INIT_ERROR);
+
+    if (lines_count == 0 || (lines_count & (lines_count - 1)) != 0)
+        return INIT_ERROR;
+
+    this->lines = lines;
+    this->mask = lines_count - 1;
+    for (uint32_t i = 0; i < lines_count; i++) {
+#ifdef PINGO_THREADS
+        atomic_init(&lines[i].version, 0);
+#endif
+        lines[i].block = TEXTURE_CACHE_EMPTY;
+    }
+
+    return OK;
+}
+
+int texture_cache_clear(TextureCache *this)
+{
+    IF_NULL_RETURN(this, SET_ERROR);
+
+    for (uint32_t i = 0; i <= this->mask; i++)
+        this->lines[i].block = TEXTURE_CACHE_EMPTY;
+
+    return OK;
+}
+
+void texture_cache_store(TextureCache *this, uint32_t block, const Pixel *texels)
+{
+    TextureCacheLine *line = &this->lines[block & this->mask];
+
+#ifdef PINGO_THREADS
+    //Another thread writing the line wins, the block stays uncached
+    unsigned version = atomic_load_explicit(&line->version, memory_order_relaxed);
+    if ((version & 1) ||
+        !atomic_compare_exchange_strong_explicit(&line->version, &version, version + 1,
+                                                 memory_order_relaxed, memory_order_relaxed))
+        return;
+    atomic_thread_fence(memory_order_release);
+#endif
+
+    line->block = block;
+    memcpy(line->texels, texels, sizeof(line->texels));
+
+#ifdef PINGO_THREADS
+    atomic_store_explicit(&line->version, version + 2, memory_order_release);
+#endif
+}
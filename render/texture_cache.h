@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pixel.h"
+
+#ifdef PINGO_THREADS
+#include <stdatomic.h>
+#endif
+
+/**
+ * Decoded block cache.
+ *
+ * Decoding a BC1 block on every fetch expands and interpolates its two end
+ * point colors for a single texel, though the neighbouring fetches mostly
+ * land in the same block. The cache keeps the 16 texels of recently decoded
+ * blocks: a hit is a tag compare and a load, a miss decodes the whole block
+ * once for the fetches to come.
+ *
+ * The cache is direct mapped, a block goes to the line of its index modulo
+ * the number of lines, so consecutive blocks of a row never evict each
+ * other. It is provided by the caller and shared by the fetches of every
+ * thread: with PINGO_THREADS each line carries a version, odd while it is
+ * being written, and a read that raced with a write is a miss.
+ */
+
+#define TEXTURE_CACHE_TEXELS 16
+#define TEXTURE_CACHE_EMPTY UINT32_MAX
+
+typedef struct TextureCacheLine {
+#ifdef PINGO_THREADS
+  atomic_uint version;
+#endif
+  uint32_t block; // TEXTURE_CACHE_EMPTY when unused
+  Pixel texels[TEXTURE_CACHE_TEXELS];
+} TextureCacheLine;
+
+typedef struct TextureCache {
+  TextureCacheLine *lines;
+  uint32_t mask; // Lines count - 1
+} TextureCache;
+
+/// lines_count must be a power of two
+extern int texture_cache_init(TextureCache *this, TextureCacheLine *lines, uint32_t lines_count);
+
+/// Empties the cache, the texels it caches changed
+extern int texture_cache_clear(TextureCache *this);
+
+/// Stores texel of block into out and returns true when block is cached
+static inline bool texture_cache_lookup(const TextureCache *this, uint32_t block, int texel, Pixel *out)
+{
+  const TextureCacheLine *line = &this->lines[block & this->mask];
+#ifdef PINGO_THREADS
+  unsigned version = atomic_load_explicit(&line->version, memory_order_acquire);
+  if (version & 1)
+    return false;
+#endif
+  if (line->block != block)
+    return false;
+  Pixel value = line->texels[texel];
+#ifdef PINGO_THREADS
+  atomic_thread_fence(memory_order_acquire);
+  if (atomic_load_explicit(&line->version, memory_order_relaxed) != version)
+    return false;
+#endif
+  *out = value;
+  return true;
+}
+
+/// Caches the TEXTURE_CACHE_TEXELS texels of block
+extern void texture_cache_store(TextureCache *this, uint32_t block, const Pixel *texels);
@@ -0,0 +1,350 @@
+#include "texture.h"
+#include "render/simd.h"
+#include "render/state.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TEXTURE_MMAP
+#else
+#include <stdio.h>
+#endif
+
+// Order of the channels of the texels of a file
+typedef enum TextureFileOrder {
+    TEXTURE_FILE_RGB,
+    TEXTURE_FILE_BGR,
+} TextureFileOrder;
+
+typedef struct TextureFileTexels {
+    const uint8_t *data;
+    Vec2i size;
+    TextureFileOrder order;
+    int bytes;     // Per texel, 3 or 4
+    bool topDown;  // The first row is the top of the image
+} TextureFileTexels;
+
+#ifdef TEXTURE_MMAP
+
+// Private copy on write mapping of the whole file
+static void *texture_map(const char *filename, size_t *size)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return 0;
+
+    struct stat st;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        data = mmap(0, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return 0;
+
+    *size = st.st_size;
+    return data;
+}
+
+static void *texture_map_anonymous(size_t size)
+{
+    void *data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return data == MAP_FAILED ? 0 : data;
+}
+
+static void texture_unmap(void *data, size_t size)
+{
+    munmap(data, size);
+}
+
+#else
+
+// Without mmap the file is read whole at once
+static void *texture_map(const char *filename, size_t *size)
+{
+    FILE *file = fopen(filename, "rb");
+    if (file == 0)
+        return 0;
+
+    void *data = 0;
+    long length = -1;
+    if (fseek(file, 0, SEEK_END) == 0)
+        length = ftell(file);
+    if (length > 0 && fseek(file, 0, SEEK_SET) == 0)
+        data = malloc(length);
+    if (data != 0 && fread(data, 1, length, file) != (size_t)length) {
+        free(data);
+        data = 0;
+    }
+    fclose(file);
+
+    *size = length;
+    return data;
+}
+
+static void *texture_map_anonymous(size_t size)
+{
+    return malloc(size);
+}
+
+static void texture_unmap(void *data, size_t size)
+{
+    free(data);
+}
+
+#endif
+
+#if defined(PINGO_PIXEL_BGRA8888) || defined(PINGO_PIXEL_RGBA8888)
+
+#ifdef PINGO_PIXEL_BGRA8888
+#define TEXTURE_FILE_NATIVE TEXTURE_FILE_BGR
+#else
+#define TEXTURE_FILE_NATIVE TEXTURE_FILE_RGB
+#endif
+
+static inline uint32_t texture_swap_red_blue(uint32_t p)
+{
+    return (p & 0xFF00FF00) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16);
+}
+
+#ifdef PINGO_SIMD
+static inline VInt texture_swap_red_blue_v(VInt p)
+{
+    VInt green = vint_and(p, vint_set1((int32_t)0xFF00FF00));
+    VInt red = vint_and(vint_srl(p, 16), vint_set1(0xFF));
+    VInt blue = vint_and(vint_sll(p, 16), vint_set1(0xFF0000));
+    return vint_or(green, vint_or(red, blue));
+}
+#endif
+
+// Exchanges the count 32 bit texels of rows a and b, which may be the same
+// row, swapping red and blue on the way when swap is set
+static void texture_exchange_rows(uint8_t *a, uint8_t *b, int32_t count, bool swap)
+{
+    int32_t i = 0;
+#ifdef PINGO_SIMD
+    for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH) {
+        VInt va = vint_load(a + i * 4);
+        VInt vb = vint_load(b + i * 4);
+        if (swap) {
+            va = texture_swap_red_blue_v(va);
+            vb = texture_swap_red_blue_v(vb);
+        }
+        vint_store(a + i * 4, vb);
+        vint_store(b + i * 4, va);
+    }
+#endif
+    for (; i < count; i++) {
+        uint32_t pa, pb;
+        memcpy(&pa, a + i * 4, 4);
+        memcpy(&pb, b + i * 4, 4);
+        if (swap) {
+            pa = texture_swap_red_blue(pa);
+            pb = texture_swap_red_blue(pb);
+        }
+        memcpy(a + i * 4, &pb, 4);
+        memcpy(b + i * 4, &pa, 4);
+    }
+}
+
+// Converts 32 bit texels to pixels where they are, false when the pixels
+// are not 32 bit
+static bool texture_convert_in_place(uint8_t *data, Vec2i size, TextureFileOrder order, bool topDown)
+{
+    bool swap = order != TEXTURE_FILE_NATIVE;
+    if (!swap && !topDown)
+        return true;
+
+    int32_t stride = size.x * 4;
+    for (int32_t y = 0; y < (size.y + 1) / 2; y++) {
+        uint8_t *top = data + y * stride;
+        uint8_t *bottom = data + (size.y - 1 - y) * stride;
+        if (topDown) {
+            texture_exchange_rows(top, bottom, size.x, swap);
+        } else {
+            texture_exchange_rows(top, top, size.x, swap);
+            if (bottom != top)
+                texture_exchange_rows(bottom, bottom, size.x, swap);
+        }
+    }
+    return true;
+}
+
+#else
+
+static bool texture_convert_in_place(uint8_t *data, Vec2i size, TextureFileOrder order, bool topDown)
+{
+    return false;
+}
+
+#endif
+
+static void texture_convert(const TextureFileTexels *src, Pixel *pixels)
+{
+    int r = src->order == TEXTURE_FILE_RGB ? 0 : 2;
+    int b = 2 - r;
+    int32_t stride = src->size.x * src->bytes;
+
+    for (int32_t y = 0; y < src->size.y; y++) {
+        const uint8_t *row = src->data + (src->topDown ? src->size.y - 1 - y : y) * stride;
+        Pixel *dst = &pixels[y * src->size.x];
+        for (int32_t x = 0; x < src->size.x; x++) {
+            const uint8_t *t = row + x * src->bytes;
+            dst[x] = pixelFromRGBA(t[r], t[1], t[b], src->bytes == 4 ? t[3] : 255);
+        }
+    }
+}
+
+// Initializes f with the texels of the file mapped at data, which it takes
+// over
+static int texture_init_texels(Texture *f, const TextureFileTexels *src, void *data, size_t size)
+{
+    int32_t texels = src->size.x * src->size.y;
+
+    if (src->bytes == 4 && sizeof(Pixel) == 4 &&
+        texture_convert_in_place((uint8_t *)src->data, src->size, src->order, src->topDown)) {
+        texture_init(f, src->size, (Pixel *)src->data);
+        f->file = data;
+        f->file_size = size;
+        return OK;
+    }
+
+    Pixel *pixels = texture_map_anonymous(texels * sizeof(Pixel));
+    if (pixels == 0) {
+        texture_unmap(data, size);
+        return INIT_ERROR;
+    }
+    texture_convert(src, pixels);
+    texture_unmap(data, size);
+
+    texture_init(f, src->size, pixels);
+    f->file = pixels;
+    f->file_size = texels * sizeof(Pixel);
+    return OK;
+}
+
+int texture_init_rgbafile(Texture *f, Vec2i size, char *filename)
+{
+    IF_NULL_RETURN(f, INIT_ERROR);
+    IF_NULL_RETURN(filename, INIT_ERROR);
+
+    if (size.x <= 0 || size.y <= 0)
+        return INIT_ERROR;
+
+    size_t length;
+    uint8_t *data = texture_map(filename, &length);
+    IF_NULL_RETURN(data, INIT_ERROR);
+
+    if (length < (size_t)size.x * size.y * 4) {
+        texture_unmap(data, length);
+        return INIT_ERROR;
+    }
+
+    TextureFileTexels src = {data, size, TEXTURE_FILE_RGB, 4, true};
+    return texture_init_texels(f, &src, data, length);
+}
+
+// Next number of a PPM header, after whitespace and comments
+static bool texture_ppm_number(const uint8_t *data, size_t length, size_t *at, int32_t *value)
+{
+    size_t i = *at;
+    for (;;) {
+        while (i < length && (data[i] == ' ' || data[i] == '\t' || data[i] == '\r' || data[i] == '\n'))
+            i++;
+        if (i >= length || data[i] != '#')
+            break;
+        while (i < length && data[i] != '\n')
+            i++;
+    }
+
+    if (i >= length || data[i] < '0' || data[i] > '9')
+        return false;
+    int32_t n = 0;
+    while (i < length && data[i] >= '0' && data[i] <= '9' && n < 1000000)
+        n = n * 10 + (data[i++] - '0');
+
+    *value = n;
+    *at = i;
+    return true;
+}
+
+static bool texture_parse_ppm(const uint8_t *data, size_t length, TextureFileTexels *src)
+{
+    size_t at = 2;
+    int32_t max;
+    if (length < 2 || data[0] != 'P' || data[1] != '6' ||
+        !texture_ppm_number(data, length, &at, &src->size.x) ||
+        !texture_ppm_number(data, length, &at, &src->size.y) ||
+        !texture_ppm_number(data, length, &at, &max) || max != 255)
+        return false;
+
+    //A single whitespace separates the header from the texels
+    src->data = data + at + 1;
+    src->order = TEXTURE_FILE_RGB;
+    src->bytes = 3;
+    src->topDown = true;
+    return at + 1 + (size_t)src->size.x * src->size.y * 3 <= length;
+}
+
+static bool texture_parse_tga(const uint8_t *data, size_t length, TextureFileTexels *src)
+{
+    if (length < 18)
+        return false;
+
+    //Uncompressed true color, left to right
+    uint8_t idLength = data[0];
+    uint8_t colorMapType = data[1];
+    uint8_t imageType = data[2];
+    uint32_t colorMapLength = data[5] | data[6] << 8;
+    uint32_t colorMapBits = data[7];
+    uint8_t bits = data[16];
+    uint8_t descriptor = data[17];
+    if (imageType != 2 || (bits != 24 && bits != 32) || (descriptor & 0x10))
+        return false;
+
+    size_t offset = 18 + idLength + (colorMapType ? colorMapLength * ((colorMapBits + 7) / 8) : 0);
+    src->size = (Vec2i){data[12] | data[13] << 8, data[14] | data[15] << 8};
+    src->data = data + offset;
+    src->order = TEXTURE_FILE_BGR;
+    src->bytes = bits / 8;
+    src->topDown = (descriptor & 0x20) != 0;
+    return offset + (size_t)src->size.x * src->size.y * src->bytes <= length;
+}
+
+int texture_init_file(Texture *f, const char *filename)
+{
+    IF_NULL_RETURN(f, INIT_ERROR);
+    IF_NULL_RETURN(filename, INIT_ERROR);
+
+    size_t length;
+    uint8_t *data = texture_map(filename, &length);
+    IF_NULL_RETURN(data, INIT_ERROR);
+
+    TextureFileTexels src;
+    bool valid = length >= 2 && data[0] == 'P' && data[1] == '6'
+                     ? texture_parse_ppm(data, length, &src)
+                     : texture_parse_tga(data, length, &src);
+    if (!valid || src.size.x <= 0 || src.size.y <= 0) {
+        texture_unmap(data, length);
+        return INIT_ERROR;
+    }
+
+    return texture_init_texels(f, &src, data, length);
+}
+
+int texture_unload(Texture *f)
+{
+    IF_NULL_RETURN(f, SET_ERROR);
+
+    if (f->file != 0)
+        texture_unmap(f->file, f->file_size);
+    f->file = 0;
+    f->file_size = 0;
+    f->frameBuffer = 0;
+    f->mipmaps_count = 0;
+    return OK;
+}
@@ -0,0 +1,253 @@
+#include "tiler.h"
+#include "math/fun.h"
+#include "renderer.h"
+#include "state.h"
+
+static void tiler_reset(Tiler *this)
+{
+    int bins = this->tiles.x * this->tiles.y;
+    for (int i = 0; i < bins; i++) {
+        this->bins[i].first = TILER_EMPTY;
+        this->bins[i].last = TILER_EMPTY;
+    }
+    this->triangles_count = 0;
+    this->entries_count = 0;
+}
+
+static void tiler_rasterize_tile(Tiler *this, Renderer *r, uint32_t tile)
+{
+    TilerBin *bin = &this->bins[tile];
+    if (bin->first == TILER_EMPTY)
+        return;
+
+    int32_t tx = (tile % this->tiles.x) * TILER_TILE_SIZE;
+    int32_t ty = (tile / this->tiles.x) * TILER_TILE_SIZE;
+    Vec4i clip = {tx,
+                  ty,
+                  MIN(tx + TILER_TILE_SIZE, this->size.x),
+                  MIN(ty + TILER_TILE_SIZE, this->size.y)};
+
+    for (uint32_t e = bin->first; e != TILER_EMPTY; e = this->entries[e].next) {
+        triangle_rasterize(r, &this->triangles[this->entries[e].triangle], clip);
+    }
+}
+
+// False when the tile is completely on the outer side of one of the triangle edges
+static bool tiler_tile_overlaps(const Triangle *t, int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+{
+    const Vec2i *v[3] = {&t->a, &t->b, &t->c};
+    for (int i = 0; i < 3; i++) {
+        const Vec2i *p = v[(i + 1) % 3];
+        const Vec2i *q = v[(i + 2) % 3];
+        int32_t A = p->y - q->y;
+        int32_t B = q->x - p->x;
+        // Tile corner with the highest edge function value
+        Vec2i corner = {A > 0 ? x1 : x0, B > 0 ? y1 : y0};
+        if (orient2d(*p, *q, corner) < 0)
+            return false;
+    }
+    return true;
+}
+
+#ifdef PINGO_THREADS
+
+static void tiler_run_tiles(Tiler *this, Renderer *r)
+{
+    uint32_t tiles = this->tiles.x * this->tiles.y;
+    for (;;) {
+        uint32_t tile = atomic_fetch_add(&this->next_tile, 1);
+        if (tile >= tiles)
+            return;
+        tiler_rasterize_tile(this, r, tile);
+    }
+}
+
+static void *tiler_worker(void *arg)
+{
+    Tiler *this = arg;
+    uint32_t seen = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&this->mutex);
+        while (this->generation == seen && !this->quit)
+            pthread_cond_wait(&this->wake, &this->mutex);
+        if (this->quit) {
+            pthread_mutex_unlock(&this->mutex);
+            return 0;
+        }
+        seen = this->generation;
+        Renderer *r = this->renderer;
+        pthread_mutex_unlock(&this->mutex);
+
+        tiler_run_tiles(this, r);
+
+        pthread_mutex_lock(&this->mutex);
+        if (--this->busy == 0)
+            pthread_cond_signal(&this->done);
+        pthread_mutex_unlock(&this->mutex);
+    }
+}
+
+#endif
+
+int tiler_init(Tiler *this, Vec2i size, TilerBin *bins,
+               Triangle *triangles, uint32_t triangles_capacity,
+               TilerEntry *entries, uint32_t entries_capacity,
+               int threads)
+{
+    IF_NULL_RETURN(this, INIT_ERROR);
+    IF_NULL_RETURN(bins, INIT_ERROR);
+    IF_NULL_RETURN(triangles, INIT_ERROR);
+    IF_NULL_RETURN(entries, INIT_ERROR);
+
+    if (size.x * size.y == 0 || triangles_capacity == 0 || entries_capacity == 0)
+        return INIT_ERROR;
+
+    this->size = size;
+    this->tiles = (Vec2i){(size.x + TILER_TILE_SIZE - 1) / TILER_TILE_SIZE,
+                          (size.y + TILER_TILE_SIZE - 1) / TILER_TILE_SIZE};
+    this->bins = bins;
+    this->triangles = triangles;
+    this->triangles_capacity = triangles_capacity;
+    this->entries = entries;
+    this->entries_capacity = entries_capacity;
+    tiler_reset(this);
+
+    threads = MIN(MAX(threads, 1), TILER_MAX_THREADS);
+
+#ifdef PINGO_THREADS
+    pthread_mutex_init(&this->mutex, 0);
+    pthread_cond_init(&this->wake, 0);
+    pthread_cond_init(&this->done, 0);
+    this->generation = 0;
+    this->busy = 0;
+    this->quit = false;
+    this->renderer = 0;
+
+    //The calling thread rasterizes tiles as well
+    this->threads = 1;
+    for (int i = 0; i < threads - 1; i++) {
+        if (pthread_create(&this->workers[i], 0, &tiler_worker, this) != 0)
+            break;
+        this->threads++;
+    }
+#else
+    this->threads = 1;
+#endif
+
+    return OK;
+}
+
+int tiler_destroy(Tiler *this)
+{
+    IF_NULL_RETURN(this, SET_ERROR);
+
+#ifdef PINGO_THREADS
+    pthread_mutex_lock(&this->mutex);
+    this->quit = true;
+    pthread_cond_broadcast(&this->wake);
+    pthread_mutex_unlock(&this->mutex);
+
+    for (int i = 0; i < this->threads - 1; i++)
+        pthread_join(this->workers[i], 0);
+
+    pthread_cond_destroy(&this->done);
+    pthread_cond_destroy(&this->wake);
+    pthread_mutex_destroy(&this->mutex);
+#endif
+
+    this->threads = 1;
+    return OK;
+}
+
+int tiler_add_triangle(Tiler *this, Renderer *r, const Triangle *t)
+{
+    IF_NULL_RETURN(this, RENDER_ERROR);
+    IF_NULL_RETURN(t, RENDER_ERROR);
+
+    int32_t tx0 = t->bounds.x / TILER_TILE_SIZE;
+    int32_t ty0 = t->bounds.y / TILER_TILE_SIZE;
+    int32_t tx1 = (t->bounds.z - 1) / TILER_TILE_SIZE;
+    int32_t ty1 = (t->bounds.w - 1) / TILER_TILE_SIZE;
+    uint32_t needed = (tx1 - tx0 + 1) * (ty1 - ty0 + 1);
+
+    //Can never fit in the bins, draw it straight away to keep ordering
+    if (needed > this->entries_capacity) {
+        tiler_flush(this, r);
+        triangle_rasterize(r, t, (Vec4i){0, 0, this->size.x, this->size.y});
+        return OK;
+    }
+
+    if (this->triangles_count == this->triangles_capacity ||
+        this->entries_count + needed > this->entries_capacity)
+        tiler_flush(this, r);
+
+    uint32_t index = this->triangles_count;
+    bool binned = false;
+
+    for (int32_t ty = ty0; ty <= ty1; ty++) {
+        for (int32_t tx = tx0; tx <= tx1; tx++) {
+            int32_t x0 = tx * TILER_TILE_SIZE;
+            int32_t y0 = ty * TILER_TILE_SIZE;
+            if (needed > 1 &&
+                !tiler_tile_overlaps(t, x0, y0, x0 + TILER_TILE_SIZE - 1, y0 + TILER_TILE_SIZE - 1))
+                continue;
+
+            uint32_t e = this->entries_count++;
+            TilerBin *bin = &this->bins[tx + ty * this->tiles.x];
+            this->entries[e].triangle = index;
+            this->entries[e].next = TILER_EMPTY;
+            if (bin->last == TILER_EMPTY)
+                bin->first = e;
+            else
+                this->entries[bin->last].next = e;
+            bin->last = e;
+            binned = true;
+        }
+    }
+
+    if (binned) {
+        this->triangles[index] = *t;
+        this->triangles_count++;
+    }
+
+    return OK;
+}
+
+int tiler_flush(Tiler *this, Renderer *r)
+{
+    IF_NULL_RETURN(this, RENDER_ERROR);
+    IF_NULL_RETURN(r, RENDER_ERROR);
+
+    if (this->triangles_count == 0)
+        return OK;
+
+#ifdef PINGO_THREADS
+    if (this->threads > 1) {
+        pthread_mutex_lock(&this->mutex);
+        this->renderer = r;
+        atomic_store(&this->next_tile, 0);
+        this->busy = this->threads - 1;
+        this->generation++;
+        pthread_cond_broadcast(&this->wake);
+        pthread_mutex_unlock(&this->mutex);
+
+        tiler_run_tiles(this, r);
+
+        pthread_mutex_lock(&this->mutex);
+        while (this->busy > 0)
+            pthread_cond_wait(&this->done, &this->mutex);
+        pthread_mutex_unlock(&this->mutex);
+
+        tiler_reset(this);
+        return OK;
+    }
+#endif
+
+    uint32_t tiles = this->tiles.x * this->tiles.y;
+    for (uint32_t tile = 0; tile < tiles; tile++)
+        tiler_rasterize_tile(this, r, tile);
+
+    tiler_reset(this);
+    return OK;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "math/vec2.h"
+#include "triangle.h"
+
+#ifdef PINGO_THREADS
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+
+/**
+ * Sort-middle tiled rasterization.
+ *
+ * Instead of being rasterized as soon as they come out of the geometry stage
+ * triangles are stored and binned into the screen tiles they overlap. When the
+ * tiler is flushed every tile is rasterized on its own, one tile at a time per
+ * thread, so the color and depth rows touched by a thread stay in its caches
+ * and tiles that no triangle touches are skipped entirely.
+ *
+ * Like the rest of the library the tiler does not allocate: the bins, the
+ * triangle storage and the bin entries are provided by the caller. When the
+ * storage fills up the pending triangles are flushed and binning restarts.
+ *
+ * When PINGO_THREADS is defined the tiles are rasterized by a pool of
+ * pthreads, otherwise they are rasterized in order by the calling thread.
+ */
+
+#define TILER_TILE_SIZE 64
+#define TILER_MAX_THREADS 32
+#define TILER_EMPTY UINT32_MAX
+
+// Number of TilerBin needed to cover a width x height screen
+#define TILER_BINS_COUNT(width, height)                                        \
+  ((((width) + TILER_TILE_SIZE - 1) / TILER_TILE_SIZE) *                       \
+   (((height) + TILER_TILE_SIZE - 1) / TILER_TILE_SIZE))
+
+// Linked list of the triangles overlapping a tile, in submission order
+typedef struct TilerBin {
+  uint32_t first;
+  uint32_t last;
+} TilerBin;
+
+typedef struct TilerEntry {
+  uint32_t triangle;
+  uint32_t next;
+} TilerEntry;
+
+typedef struct Tiler {
+  Vec2i size;  // Screen size in pixels
+  Vec2i tiles; // Screen size in tiles
+
+  TilerBin *bins;
+
+  Triangle *triangles;
+  uint32_t triangles_capacity;
+  uint32_t triangles_count;
+
+  TilerEntry *entries;
+  uint32_t entries_capacity;
+  uint32_t entries_count;
+
+  int threads;
+
+#ifdef PINGO_THREADS
+  pthread_t workers[TILER_MAX_THREADS];
+  pthread_mutex_t mutex;
+  pthread_cond_t wake;
+  pthread_cond_t done;
+  uint32_t generation;
+  int busy;
+  bool quit;
+  Renderer *renderer;
+  atomic_uint next_tile;
+#endif
+} Tiler;
+
+/// Initializes the tiler for a screen of the given size. bins must hold
+/// TILER_BINS_COUNT(size.x, size.y) elements. threads is the number of
+/// threads rasterizing tiles, the caller included.
+extern int tiler_init(Tiler *this, Vec2i size, TilerBin *bins,
+                      Triangle *triangles, uint32_t triangles_capacity,
+                      TilerEntry *entries, uint32_t entries_capacity,
+                      int threads);
+
+/// Stops the worker threads, if any
+extern int tiler_destroy(Tiler *this);
+
+/// Bins a triangle, flushing the pending ones first if the storage is full
+extern int tiler_add_triangle(Tiler *this, Renderer *r, const Triangle *t);
+
+/// Rasterizes every pending triangle and empties the bins
+extern int tiler_flush(Tiler *this, Renderer *r);
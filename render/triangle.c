@@ -0,0 +1,397 @@
+#include "triangle.h"
+#include "backend.h"
+#include "clear.h"
+#include "depth.h"
+#include "math/fun.h"
+#include "render/material.h"
+#include "renderer.h"
+#include "simd.h"
+#include "visibility.h"
+
+#include <math.h>
+
+// Blocks match the coarse depth tiles
+#define TRIANGLE_BLOCK_SIZE DEPTH_HIZ_TILE
+
+// Texture coordinates are computed exactly every TRIANGLE_UV_STEP pixels of a
+// row and interpolated linearly in between, so the perspective divide is paid
+// once per group of pixels instead of once per pixel
+#define TRIANGLE_UV_STEP 8
+
+// Plane equation of an attribute over the screen: base + dx * x + dy * y, x
+// and y being relative to the top left corner of the triangle bounds
+typedef struct TrianglePlane {
+    float base, dx, dy;
+} TrianglePlane;
+
+// Perspective correct texture coordinates of a triangle
+typedef struct TriangleTexcoord {
+    TrianglePlane w;    // 1 / w
+    TrianglePlane u, v; // Texture coordinates divided by w
+    float wMin, wMax;   // 1 / w range over the triangle
+    int32_t x, y;       // Pixel group cached below, x is -1 when none
+    Vec2f uv;           // Texture coordinates at the start of the group
+    Vec2f step;         // and their step along x
+    bool mipmapped;     // Whether the level of detail is needed
+    Vec2f texels;       // Size of the base level of the texture
+    float lod;          // Level of detail of the group
+    const Sampler *sampler; // Fetches the texels
+    Vec2i texel;        // 16.16 texel coordinates at the start of the group
+    Vec2i texelStep;    // and their step along x
+} TriangleTexcoord;
+
+typedef struct TriangleRaster TriangleRaster;
+
+// Rasterizes the rows [y0, y1) of the columns [x0, x1), w0/w1/w2 being the
+// edge functions at x0/y0, see triangle_depth.h
+typedef void (*TriangleRect)(TriangleRaster *tr, int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+                             int32_t w0, int32_t w1, int32_t w2, bool edges);
+
+// Per triangle state shared by the span loops
+struct TriangleRaster {
+    Renderer *r;
+    const Triangle *t;
+    DepthFormat format;
+    void *zetaBuffer;      // Elements of the depth format
+    uint32_t *ids;         // Visibility buffer, 0 when shading right away
+    int32_t stride;
+    int32_t A01, A12, A20; // Edge function steps along x
+    int32_t B01, B12, B20; // Edge function steps along y
+    TriangleRect rect;     // Span loops of the depth format
+    float d0, d1, d2;      // Depth of the vertices in the depth format
+    PingoDepth *hiz;       // Coarse depth buffer, can be 0
+    int32_t hizStride;
+    bool hizReject;        // Whether blocks can be rejected against hiz
+    float depthMin;        // Depth at the minX/minY corner of the box
+    float depthDx, depthDy; // Depth steps
+    float depthMax;        // Farthest depth the triangle can produce
+    bool written;          // A depth was written since the flag was reset
+    TriangleTexcoord texcoord;
+};
+
+// Slack on depth bounds, covers the rounding of the per pixel interpolation
+#define TRIANGLE_DEPTH_EPSILON 1e-5f
+
+static TrianglePlane triangle_plane(Vec2f origin, Vec2f dx, Vec2f dy,
+                                    float a, float b, float c)
+{
+    float l2 = 1.0f - origin.x - origin.y;
+    float dx2 = -dx.x - dx.y;
+    float dy2 = -dy.x - dy.y;
+    return (TrianglePlane){origin.x * a + origin.y * b + l2 * c,
+                           dx.x * a + dx.y * b + dx2 * c,
+                           dy.x * a + dy.y * b + dy2 * c};
+}
+
+// Sets up the attribute planes from the barycentric coordinates of the
+// triangle at the corner of its bounds and their steps
+static void triangle_texcoord_init(TriangleTexcoord *tc, const Triangle *t)
+{
+    Vec2i corner = {t->bounds.x, t->bounds.y};
+    Vec2f origin = {orient2d(t->b, t->c, corner) * t->areaInverse,
+                    orient2d(t->c, t->a, corner) * t->areaInverse};
+    Vec2f dx = {(t->b.y - t->c.y) * t->areaInverse, (t->c.y - t->a.y) * t->areaInverse};
+    Vec2f dy = {(t->c.x - t->b.x) * t->areaInverse, (t->a.x - t->c.x) * t->areaInverse};
+
+    tc->w = triangle_plane(origin, dx, dy, t->wa, t->wb, t->wc);
+    tc->u = triangle_plane(origin, dx, dy, t->tca.x, t->tcb.x, t->tcc.x);
+    tc->v = triangle_plane(origin, dx, dy, t->tca.y, t->tcb.y, t->tcc.y);
+    tc->wMin = MIN(MIN(t->wa, t->wb), t->wc);
+    tc->wMax = MAX(MAX(t->wa, t->wb), t->wc);
+    const Texture *texture = t->material->texture;
+    tc->mipmapped = texture->filter != TEXTURE_NEAREST && texture->mipmaps_count > 0;
+    tc->texels = (Vec2f){texture->size.x, texture->size.y};
+    tc->sampler = &t->material->sampler;
+    tc->x = -1;
+    tc->y = -1;
+}
+
+// Exact texture coordinates at x/y. 1 / w is clamped to the range it takes
+// inside the triangle since the last pixel of a group can lie outside of it
+static inline Vec2f triangle_texcoord_at(const TriangleTexcoord *tc, float x, float y)
+{
+    float w = tc->w.base + tc->w.dx * x + tc->w.dy * y;
+    float z = 1.0f / MIN(MAX(w, tc->wMin), tc->wMax);
+    return (Vec2f){(tc->u.base + tc->u.dx * x + tc->u.dy * y) * z,
+                   (tc->v.base + tc->v.dx * x + tc->v.dy * y) * z};
+}
+
+// Level of detail at x/y: log2 of the texels of the base level spanned by a
+// pixel step, along the screen axis where the texture coordinates change the
+// most. The derivatives of u = U / W are (dU - u * dW) / W
+static inline float triangle_texcoord_lod(const TriangleTexcoord *tc, float x, float y)
+{
+    float w = tc->w.base + tc->w.dx * x + tc->w.dy * y;
+    float z = 1.0f / MIN(MAX(w, tc->wMin), tc->wMax);
+    float u = (tc->u.base + tc->u.dx * x + tc->u.dy * y) * z;
+    float v = (tc->v.base + tc->v.dx * x + tc->v.dy * y) * z;
+
+    float dudx = (tc->u.dx - u * tc->w.dx) * z * tc->texels.x;
+    float dvdx = (tc->v.dx - v * tc->w.dx) * z * tc->texels.y;
+    float dudy = (tc->u.dy - u * tc->w.dy) * z * tc->texels.x;
+    float dvdy = (tc->v.dy - v * tc->w.dy) * z * tc->texels.y;
+    float rho2 = MAX(dudx * dudx + dvdx * dvdx, dudy * dudy + dvdy * dvdy);
+    return 0.5f * log2f(rho2);
+}
+
+// Sets up the group of pixel x/y, relative to the corner of the bounds, and
+// returns the offset of x in the group. Mipmapped textures get the level of
+// detail of the group, the others its fixed point texel coordinates
+static inline int32_t triangle_texcoord_group(TriangleTexcoord *tc, int32_t x, int32_t y)
+{
+    int32_t group = x & ~(TRIANGLE_UV_STEP - 1);
+    if (group != tc->x || y != tc->y) {
+        Vec2f last = triangle_texcoord_at(tc, group + TRIANGLE_UV_STEP - 1, y);
+        tc->uv = triangle_texcoord_at(tc, group, y);
+        tc->step = (Vec2f){(last.x - tc->uv.x) * (1.0f / (TRIANGLE_UV_STEP - 1)),
+                           (last.y - tc->uv.y) * (1.0f / (TRIANGLE_UV_STEP - 1))};
+        tc->x = group;
+        tc->y = y;
+        if (tc->mipmapped) {
+            tc->lod = triangle_texcoord_lod(tc, group + TRIANGLE_UV_STEP / 2, y);
+        } else {
+            tc->texel = (Vec2i){sampler_fixed(tc->sampler, tc->uv.x, tc->texels.x),
+                                sampler_fixed(tc->sampler, tc->uv.y, tc->texels.y)};
+            tc->texelStep = (Vec2i){(int32_t)(tc->step.x * tc->texels.x * SAMPLER_ONE),
+                                    (int32_t)(tc->step.y * tc->texels.y * SAMPLER_ONE)};
+        }
+    }
+
+    return x - group;
+}
+
+// Texture coordinates of pixel x/y, relative to the corner of the bounds
+static inline Vec2f triangle_texcoord(TriangleTexcoord *tc, int32_t x, int32_t y)
+{
+    float k = triangle_texcoord_group(tc, x, y);
+    return (Vec2f){tc->uv.x + tc->step.x * k, tc->uv.y + tc->step.y * k};
+}
+
+// Texel of pixel x/y, relative to the corner of the bounds, for textures
+// without mipmaps
+static inline Pixel triangle_texel(TriangleTexcoord *tc, int32_t x, int32_t y)
+{
+    int32_t k = triangle_texcoord_group(tc, x, y);
+    return sampler_read(tc->sampler, tc->texel.x + tc->texelStep.x * k,
+                        tc->texel.y + tc->texelStep.y * k);
+}
+
+// Texturing and lighting of a pixel
+static inline void triangle_color(Renderer *r, const Triangle *t, TriangleTexcoord *tc,
+                                  int32_t x, int32_t y)
+{
+    if (t->material != 0) {
+        //Texture lookup
+        Pixel text;
+        if (tc->mipmapped) {
+            Vec2f uv = triangle_texcoord(tc, x - t->bounds.x, y - t->bounds.y);
+            text = sampler_read_lod(tc->sampler, uv, tc->lod);
+        } else {
+            text = triangle_texel(tc, x - t->bounds.x, y - t->bounds.y);
+        }
+        texture_draw(&r->framebuffer, (Vec2i){x, y}, pixelShade(text, t->light, x, y));
+    } else {
+        texture_draw(&r->framebuffer,
+                     (Vec2i){x, y},
+                     pixelShade(pixelFromUInt8(255), t->light, x, y));
+    }
+}
+
+// Shades a fragment that passed the depth test, or just records the triangle
+// id in visibility buffer mode
+static inline void triangle_fragment(TriangleRaster *tr, int32_t x, int32_t y)
+{
+    if (tr->ids != 0)
+        tr->ids[x + y * tr->stride] = tr->t->id;
+    else
+        triangle_color(tr->r, tr->t, &tr->texcoord, x, y);
+}
+
+#define TRIANGLE_CONCAT_(name, suffix) name##_##suffix
+#define TRIANGLE_CONCAT(name, suffix) TRIANGLE_CONCAT_(name, suffix)
+#define TRIANGLE_DEPTH_NAME(name) TRIANGLE_CONCAT(name, TRIANGLE_DEPTH_SUFFIX)
+
+#define TRIANGLE_DEPTH_SUFFIX 32
+#define TRIANGLE_DEPTH_TYPE uint32_t
+#define TRIANGLE_DEPTH_ENCODE(v) depth_encode32(v)
+#define TRIANGLE_DEPTH_VALID(v) ((v) >= -1.0f && (v) <= 1.0f)
+#ifdef PINGO_SIMD
+#define TRIANGLE_DEPTH_SIMD
+#endif
+#include "triangle_depth.h"
+
+#define TRIANGLE_DEPTH_SUFFIX 16
+#define TRIANGLE_DEPTH_TYPE uint16_t
+#define TRIANGLE_DEPTH_ENCODE(v) depth_encode16(v)
+#define TRIANGLE_DEPTH_VALID(v) ((v) >= 0 && (v) <= 1.0f)
+#include "triangle_depth.h"
+
+#define TRIANGLE_DEPTH_SUFFIX 8
+#define TRIANGLE_DEPTH_TYPE uint8_t
+#define TRIANGLE_DEPTH_ENCODE(v) depth_encode8(v)
+#define TRIANGLE_DEPTH_VALID(v) ((v) >= 0 && (v) <= 1.0f)
+#include "triangle_depth.h"
+
+// 1 / w, positive in front of the camera
+#define TRIANGLE_DEPTH_SUFFIX float
+#define TRIANGLE_DEPTH_TYPE float
+#define TRIANGLE_DEPTH_ENCODE(v) (v)
+#define TRIANGLE_DEPTH_VALID(v) ((v) > 0)
+#include "triangle_depth.h"
+
+// Largest and smallest value an edge function takes over a w x h pixels block
+#define EDGE_MAX(e, A, B, w, h) ((e) + MAX((A) * ((w) - 1), 0) + MAX((B) * ((h) - 1), 0))
+#define EDGE_MIN(e, A, B, w, h) ((e) + MIN((A) * ((w) - 1), 0) + MIN((B) * ((h) - 1), 0))
+
+// Walks the bounding box in TRIANGLE_BLOCK_SIZE blocks. Blocks outside one of
+// the edges are skipped, blocks inside all of them are drawn without edge
+// tests and only the blocks crossing an edge are tested pixel by pixel.
+// With a coarse depth buffer blocks entirely behind the stored depth are
+// skipped as well, and the coarse depth of the blocks drawn into is refreshed
+static void triangle_blocks(TriangleRaster *tr, int32_t minX, int32_t minY,
+                            int32_t maxX, int32_t maxY,
+                            int32_t w0_min, int32_t w1_min, int32_t w2_min)
+{
+    const int32_t size = TRIANGLE_BLOCK_SIZE;
+
+    for (int32_t by = minY & ~(size - 1); by < maxY; by += size) {
+        int32_t y0 = MAX(by, minY);
+        int32_t y1 = MIN(by + size, maxY);
+
+        for (int32_t bx = minX & ~(size - 1); bx < maxX; bx += size) {
+            int32_t x0 = MAX(bx, minX);
+            int32_t x1 = MIN(bx + size, maxX);
+
+            int32_t dx = x0 - minX;
+            int32_t dy = y0 - minY;
+            int32_t w0 = w0_min + dx * tr->A12 + dy * tr->B12;
+            int32_t w1 = w1_min + dx * tr->A20 + dy * tr->B20;
+            int32_t w2 = w2_min + dx * tr->A01 + dy * tr->B01;
+
+            int32_t w = x1 - x0;
+            int32_t h = y1 - y0;
+
+            if (EDGE_MAX(w0, tr->A12, tr->B12, w, h) < 0 ||
+                EDGE_MAX(w1, tr->A20, tr->B20, w, h) < 0 ||
+                EDGE_MAX(w2, tr->A01, tr->B01, w, h) < 0)
+                continue;
+
+            int32_t hizIdx = bx / size + (by / size) * tr->hizStride;
+            if (tr->hizReject) {
+                float depth = tr->depthMin + dx * tr->depthDx + dy * tr->depthDy +
+                              MAX(tr->depthDx * (w - 1), 0) + MAX(tr->depthDy * (h - 1), 0);
+                depth = MIN(depth + TRIANGLE_DEPTH_EPSILON, tr->depthMax);
+                if (depth_hiz_reject(tr->format, tr->hiz, hizIdx, depth))
+                    continue;
+            }
+
+            bool covered = EDGE_MIN(w0, tr->A12, tr->B12, w, h) >= 0 &&
+                           EDGE_MIN(w1, tr->A20, tr->B20, w, h) >= 0 &&
+                           EDGE_MIN(w2, tr->A01, tr->B01, w, h) >= 0;
+
+            if (tr->r->clear_blocks != 0 && (tr->r->clear_blocks[hizIdx] & CLEAR_TOUCHED) == 0)
+                clear_block(tr->r, bx / size, by / size);
+
+            tr->written = false;
+            tr->rect(tr, x0, y0, x1, y1, w0, w1, w2, !covered);
+
+            if (tr->hiz != 0 && tr->written) {
+                const Vec2i scrSize = tr->r->framebuffer.size;
+                depth_hiz_update(tr->format, tr->hiz, hizIdx, tr->zetaBuffer, bx + by * tr->stride,
+                                 tr->stride, MIN(size, scrSize.x - bx), MIN(size, scrSize.y - by));
+            }
+        }
+    }
+}
+
+void triangle_rasterize(Renderer *r, const Triangle *t, Vec4i clip)
+{
+    int32_t minX = MAX(t->bounds.x, clip.x);
+    int32_t minY = MAX(t->bounds.y, clip.y);
+    int32_t maxX = MIN(t->bounds.z, clip.z);
+    int32_t maxY = MIN(t->bounds.w, clip.w);
+
+    if (minX >= maxX || minY >= maxY)
+        return;
+
+    const Vec2i a_s = t->a;
+    const Vec2i b_s = t->b;
+    const Vec2i c_s = t->c;
+
+    TriangleRaster tr;
+    tr.r = r;
+    tr.t = t;
+    tr.zetaBuffer = r->backend->getZetaBuffer(r, r->backend);
+    tr.stride = r->framebuffer.size.x;
+    tr.ids = r->visibility != 0 ? r->visibility->ids : 0;
+    if (tr.ids == 0 && t->material != 0)
+        triangle_texcoord_init(&tr.texcoord, t);
+
+    // Barycentric coordinates at minX/minY corner
+    Vec2i minTriangle = {minX, minY};
+
+    tr.A01 = (a_s.y - b_s.y); //Barycentric coordinates steps
+    tr.B01 = (b_s.x - a_s.x); //Barycentric coordinates steps
+    tr.A12 = (b_s.y - c_s.y); //Barycentric coordinates steps
+    tr.B12 = (c_s.x - b_s.x); //Barycentric coordinates steps
+    tr.A20 = (c_s.y - a_s.y); //Barycentric coordinates steps
+    tr.B20 = (a_s.x - c_s.x); //Barycentric coordinates steps
+
+    int32_t w0 = orient2d(b_s, c_s, minTriangle);
+    int32_t w1 = orient2d(c_s, a_s, minTriangle);
+    int32_t w2 = orient2d(a_s, b_s, minTriangle);
+
+    tr.format = r->depth_format;
+    switch (tr.format) {
+    case DEPTH_16:
+        tr.rect = &triangle_rect_16;
+        break;
+    case DEPTH_8:
+        tr.rect = &triangle_rect_8;
+        break;
+    case DEPTH_FLOAT:
+        tr.rect = &triangle_rect_float;
+        break;
+    default:
+        tr.rect = &triangle_rect_32;
+        break;
+    }
+
+    //Reversed-Z interpolates 1 / w, the other formats the device depth
+    if (tr.format == DEPTH_FLOAT) {
+        tr.d0 = t->wa;
+        tr.d1 = t->wb;
+        tr.d2 = t->wc;
+    } else {
+        tr.d0 = -t->za;
+        tr.d1 = -t->zb;
+        tr.d2 = -t->zc;
+    }
+
+    tr.hiz = r->hiz;
+    tr.hizStride = (r->framebuffer.size.x + TRIANGLE_BLOCK_SIZE - 1) / TRIANGLE_BLOCK_SIZE;
+    tr.depthMax = MAX(MAX(tr.d0, tr.d1), tr.d2) + TRIANGLE_DEPTH_EPSILON;
+    // Negative depths do not map monotonically to the stored values
+    tr.hizReject = tr.hiz != 0 && MIN(MIN(tr.d0, tr.d1), tr.d2) >= 0;
+    tr.depthMin = (w0 * tr.d0 + w1 * tr.d1 + w2 * tr.d2) * t->areaInverse;
+    tr.depthDx = (tr.A12 * tr.d0 + tr.A20 * tr.d1 + tr.A01 * tr.d2) * t->areaInverse;
+    tr.depthDy = (tr.B12 * tr.d0 + tr.B20 * tr.d1 + tr.B01 * tr.d2) * t->areaInverse;
+
+    //Small triangles are cheaper to scan than to classify, unless the
+    //classification can use the coarse depth buffer or the blocks need a
+    //lazy clear
+    if (tr.hiz == 0 && r->clear_blocks == 0 && maxX - minX <= TRIANGLE_BLOCK_SIZE && maxY - minY <= TRIANGLE_BLOCK_SIZE)
+        tr.rect(&tr, minX, minY, maxX, maxY, w0, w1, w2, true);
+    else
+        triangle_blocks(&tr, minX, minY, maxX, maxY, w0, w1, w2);
+}
+
+void triangle_shade_span(Renderer *r, const Triangle *t, int32_t x0, int32_t x1, int32_t y)
+{
+    TriangleTexcoord tc;
+    if (t->material != 0)
+        triangle_texcoord_init(&tc, t);
+
+    for (int32_t x = x0; x < x1; x++)
+        triangle_color(r, t, &tc, x, y);
+}
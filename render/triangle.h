@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "math/vec2.h"
+#include "math/vec4.h"
+
+typedef struct Renderer Renderer;
+typedef struct Material Material;
+
+/// A triangle that went through the geometry stage: projected to screen
+/// space, culled and ready to be rasterized. It holds everything the
+/// rasterizer needs so it can be stored and rasterized later (see tiler.h)
+typedef struct Triangle {
+  Vec2i a, b, c;         // Screen space vertices
+  float za, zb, zc;      // Device depth of the vertices
+  float wa, wb, wc;      // 1 / w of the vertices
+  Vec2f tca, tcb, tcc;   // Texture coordinates divided by w
+  uint32_t light;        // Diffuse light factor of the face, out of 256
+  Material *material;    // Can be 0, the face is then drawn flat
+  int32_t area;          // Signed double area, never 0
+  float areaInverse;     // 1 / area
+  Vec4i bounds;          // Screen bounding box as {minX, minY, maxX, maxY}, max excluded
+  uint32_t id;           // Visibility buffer id, see visibility.h
+} Triangle;
+
+/// Rasterizes the part of the triangle which falls inside the clip rect
+/// ({minX, minY, maxX, maxY}, max excluded) into the renderer buffers
+extern void triangle_rasterize(Renderer *r, const Triangle *t, Vec4i clip);
+
+/// Shades the pixels [x0, x1) of row y of the triangle into the framebuffer,
+/// without depth test. Used to resolve the visibility buffer: the attribute
+/// planes are set up once for the span and its pixel groups are shared
+extern void triangle_shade_span(Renderer *r, const Triangle *t, int32_t x0, int32_t x1, int32_t y);
@@ -0,0 +1,135 @@
+// Span loops of the rasterizer for one depth format, included by triangle.c
+// once per format so that the depth test costs no branch per pixel. The
+// includer defines:
+//  TRIANGLE_DEPTH_SUFFIX     suffix of the function names
+//  TRIANGLE_DEPTH_TYPE       type of a depth buffer element
+//  TRIANGLE_DEPTH_ENCODE(v)  value stored for the depth v
+//  TRIANGLE_DEPTH_VALID(v)   whether the depth v can be stored
+//  TRIANGLE_DEPTH_SIMD       when the vector loop applies, 32 bit only
+
+// Edge test, depth test and shading of a single pixel. The edge test is
+// skipped when the pixel is known to be inside the triangle
+static inline void TRIANGLE_DEPTH_NAME(triangle_pixel)(TriangleRaster *tr, int32_t x, int32_t y,
+                                                       int32_t w0, int32_t w1, int32_t w2, bool edges)
+{
+    if (edges && (w0 | w1 | w2) < 0)
+        return;
+
+    float depth = (w0 * tr->d0 + w1 * tr->d1 + w2 * tr->d2) * tr->t->areaInverse;
+    if (!TRIANGLE_DEPTH_VALID(depth))
+        return;
+
+    TRIANGLE_DEPTH_TYPE *zeta = tr->zetaBuffer;
+    int32_t idx = x + y * tr->stride;
+    TRIANGLE_DEPTH_TYPE value = TRIANGLE_DEPTH_ENCODE(depth);
+    if (value < zeta[idx])
+        return;
+
+    zeta[idx] = value;
+    tr->written = true;
+    triangle_fragment(tr, x, y);
+}
+
+#ifdef TRIANGLE_DEPTH_SIMD
+
+// Rasterizes SIMD_WIDTH pixels starting at x: edge functions, depth
+// interpolation and depth test are evaluated for all of them at once, the
+// depth buffer is updated with a masked store and only the surviving lanes
+// are shaded
+static inline void TRIANGLE_DEPTH_NAME(triangle_pixels)(TriangleRaster *tr, int32_t x, int32_t y,
+                                                        VInt w0, VInt w1, VInt w2, bool edges)
+{
+    VInt covered = vint_set1(0);
+    if (edges) {
+        covered = vint_negative(vint_or(vint_or(w0, w1), w2));
+        if (vint_movemask(covered) == (1 << SIMD_WIDTH) - 1)
+            return;
+    }
+
+    VFloat fw0 = vfloat_from_vint(w0);
+    VFloat fw1 = vfloat_from_vint(w1);
+    VFloat fw2 = vfloat_from_vint(w2);
+    VFloat sum = vfloat_add(vfloat_add(vfloat_mul(fw0, vfloat_set1(tr->d0)),
+                                       vfloat_mul(fw1, vfloat_set1(tr->d1))),
+                            vfloat_mul(fw2, vfloat_set1(tr->d2)));
+    VFloat depth = vfloat_mul(sum, vfloat_set1(tr->t->areaInverse));
+
+    // Lanes to drop: outside the triangle or out of depth range
+    VInt reject = vint_or(covered, vint_or(vfloat_cmplt(depth, vfloat_set1(-1.0f)),
+                                           vfloat_cmplt(vfloat_set1(1.0f), depth)));
+
+    TRIANGLE_DEPTH_TYPE *zeta = tr->zetaBuffer;
+    int32_t idx = x + y * tr->stride;
+    VInt stored = vint_load(&zeta[idx]);
+    VInt value = vfloat_to_u32(vfloat_mul(depth, vfloat_set1((float)UINT32_MAX)));
+    reject = vint_or(reject, vint_cmplt_u32(value, stored));
+
+    int mask = ~vint_movemask(reject) & ((1 << SIMD_WIDTH) - 1);
+    if (mask == 0)
+        return;
+
+    vint_store(&zeta[idx], vint_or(vint_and(reject, stored), vint_andnot(reject, value)));
+    tr->written = true;
+
+    for (int l = 0; l < SIMD_WIDTH; l++) {
+        if (mask & (1 << l))
+            triangle_fragment(tr, x + l, y);
+    }
+}
+
+#endif
+
+// Rasterizes the pixels [x0, x1) of row y, w0/w1/w2 being the edge functions
+// at x0. edges is false when the whole span is known to be inside the triangle
+static inline void TRIANGLE_DEPTH_NAME(triangle_span)(TriangleRaster *tr, int32_t y, int32_t x0, int32_t x1,
+                                                      int32_t w0, int32_t w1, int32_t w2, bool edges)
+{
+    int32_t x = x0;
+
+#ifdef TRIANGLE_DEPTH_SIMD
+    if (x1 - x0 >= SIMD_WIDTH) {
+        int32_t l0[SIMD_WIDTH], l1[SIMD_WIDTH], l2[SIMD_WIDTH];
+        for (int l = 0; l < SIMD_WIDTH; l++) {
+            l0[l] = w0 + l * tr->A12;
+            l1[l] = w1 + l * tr->A20;
+            l2[l] = w2 + l * tr->A01;
+        }
+        VInt vw0 = vint_load(l0);
+        VInt vw1 = vint_load(l1);
+        VInt vw2 = vint_load(l2);
+        VInt s0 = vint_set1(tr->A12 * SIMD_WIDTH);
+        VInt s1 = vint_set1(tr->A20 * SIMD_WIDTH);
+        VInt s2 = vint_set1(tr->A01 * SIMD_WIDTH);
+
+        for (; x + SIMD_WIDTH <= x1; x += SIMD_WIDTH) {
+            TRIANGLE_DEPTH_NAME(triangle_pixels)(tr, x, y, vw0, vw1, vw2, edges);
+            vw0 = vint_add(vw0, s0);
+            vw1 = vint_add(vw1, s1);
+            vw2 = vint_add(vw2, s2);
+        }
+
+        w0 += (x - x0) * tr->A12;
+        w1 += (x - x0) * tr->A20;
+        w2 += (x - x0) * tr->A01;
+    }
+#endif
+
+    for (; x < x1; x++, w0 += tr->A12, w1 += tr->A20, w2 += tr->A01)
+        TRIANGLE_DEPTH_NAME(triangle_pixel)(tr, x, y, w0, w1, w2, edges);
+}
+
+// Rasterizes the rows [y0, y1) of the columns [x0, x1), w0/w1/w2 being the
+// edge functions at x0/y0
+static void TRIANGLE_DEPTH_NAME(triangle_rect)(TriangleRaster *tr, int32_t x0, int32_t y0,
+                                               int32_t x1, int32_t y1,
+                                               int32_t w0, int32_t w1, int32_t w2, bool edges)
+{
+    for (int32_t y = y0; y < y1; y++, w0 += tr->B12, w1 += tr->B20, w2 += tr->B01)
+        TRIANGLE_DEPTH_NAME(triangle_span)(tr, y, x0, x1, w0, w1, w2, edges);
+}
+
+#undef TRIANGLE_DEPTH_SUFFIX
+#undef TRIANGLE_DEPTH_TYPE
+#undef TRIANGLE_DEPTH_ENCODE
+#undef TRIANGLE_DEPTH_VALID
+#undef TRIANGLE_DEPTH_SIMD
@@ -0,0 +1,21 @@
+#include "vertex.h"
+
+void vertex_transform(Vertex *out, const Vec3f *positions, int count,
+                      Mat4 *modelView, Mat4 *projection, Vec2f guard)
+{
+    for (int i = 0; i < count; i++) {
+        Vec4f p = {positions[i].x, positions[i].y, positions[i].z, 1};
+
+        p = mat4MultiplyVec4(&p, modelView);
+        out[i].view = (Vec3f){p.x, p.y, p.z};
+
+        p = mat4MultiplyVec4(&p, projection);
+        out[i].clip = p;
+        out[i].clip_flags = clip_flags(p, guard);
+
+        // convert to device coordinates by perspective division
+        out[i].ndc = (Vec3f){p.x / p.w, p.y / p.w, p.z / p.w};
+        out[i].invW = 1.0f / p.w;
+        out[i].ready = true;
+    }
+}
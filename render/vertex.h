@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "math/mat4.h"
+#include "math/vec3.h"
+#include "math/vec4.h"
+#include "clip.h"
+
+/// A mesh position after the vertex stage
+typedef struct Vertex {
+  Vec3f view; // View space position, used for face normals
+  Vec4f clip; // Clip space position
+  Vec3f ndc;  // Normalized device coordinates (clip / w)
+  float invW; // 1 / clip.w, for perspective correct interpolation
+  uint8_t clip_flags; // See clip.h
+  bool ready; // Set once transformed, lets a vertex cache be filled lazily
+} Vertex;
+
+/// Transforms count positions into out, applying the model-view matrix, the
+/// projection matrix and the perspective division, and computes their clip
+/// flags against the frustum and the guard band
+extern void vertex_transform(Vertex *out, const Vec3f *positions, int count,
+                             Mat4 *modelView, Mat4 *projection, Vec2f guard);
@@ -0,0 +1,289 @@
+#include "virtual_texture.h"
+#include "math/fun.h"
+#include "render/state.h"
+
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define VIRTUAL_TEXTURE_MMAP
+#endif
+
+static const char virtual_texture_magic[4] = {'P', 'V', 'T', '1'};
+
+// Levels down to the first that fits in a single page
+static int virtual_texture_levels(Vec2i size, int32_t page)
+{
+    int levels = 1;
+    while (MAX(size.x >> (levels - 1), size.y >> (levels - 1)) > page)
+        levels++;
+    return levels;
+}
+
+static inline Vec2i virtual_texture_level_size(Vec2i size, int level)
+{
+    return (Vec2i){MAX(size.x >> level, 1), MAX(size.y >> level, 1)};
+}
+
+static inline size_t virtual_texture_page_bytes(const VirtualTexture *this)
+{
+    return (size_t)this->page * this->page * sizeof(Pixel);
+}
+
+static bool virtual_texture_open(VirtualTexture *this, const char *filename)
+{
+#ifdef VIRTUAL_TEXTURE_MMAP
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= VIRTUAL_TEXTURE_HEADER)
+        data = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    this->file = data;
+    this->file_size = st.st_size;
+    this->stream = 0;
+#else
+    this->stream = fopen(filename, "rb");
+    if (this->stream == 0)
+        return false;
+    this->file = 0;
+    this->file_size = 0;
+    if (fseek(this->stream, 0, SEEK_END) == 0)
+        this->file_size = ftell(this->stream);
+#endif
+    return true;
+}
+
+static bool virtual_texture_read(VirtualTexture *this, size_t offset, void *dst, size_t bytes)
+{
+    if (offset + bytes > this->file_size)
+        return false;
+    if (this->file != 0) {
+        memcpy(dst, this->file + offset, bytes);
+        return true;
+    }
+    return fseek(this->stream, offset, SEEK_SET) == 0 && fread(dst, 1, bytes, this->stream) == bytes;
+}
+
+// Copies page into slot
+static bool virtual_texture_load(VirtualTexture *this, uint32_t page, uint32_t slot)
+{
+    size_t bytes = virtual_texture_page_bytes(this);
+    if (!virtual_texture_read(this, VIRTUAL_TEXTURE_HEADER + page * bytes,
+                              &this->slots_pixels[(size_t)slot << (2 * this->page_shift)], bytes))
+        return false;
+
+    this->slots[slot] = page;
+    this->pages[page].slot = slot;
+    return true;
+}
+
+int virtual_texture_init(VirtualTexture *this, Texture *texture, const char *filename,
+                         VirtualPage *pages, uint32_t pages_capacity,
+                         uint32_t *slots, Pixel *slots_pixels, uint32_t slots_count)
+{
+    IF_NULL_RETURN(this, INIT_ERROR);
+    IF_NULL_RETURN(texture, INIT_ERROR);
+    IF_NULL_RETURN(filename, INIT_ERROR);
+    IF_NULL_RETURN(pages, INIT_ERROR);
+    IF_NULL_RETURN(slots, INIT_ERROR);
+    IF_NULL_RETURN(slots_pixels, INIT_ERROR);
+
+    if (slots_count < 2)
+        return INIT_ERROR;
+    if (!virtual_texture_open(this, filename))
+        return INIT_ERROR;
+
+    uint32_t header[4];
+    if (!virtual_texture_read(this, 0, header, sizeof(header)) ||
+        memcmp(header, virtual_texture_magic, 4) != 0)
+        goto error;
+
+    int32_t page = header[3];
+    this->size = (Vec2i){header[1], header[2]};
+    if (this->size.x <= 0 || this->size.y <= 0 || page <= 0 || (page & (page - 1)) != 0)
+        goto error;
+
+    this->page = page;
+    this->page_shift = 0;
+    while ((1 << this->page_shift) < page)
+        this->page_shift++;
+
+    this->levels = virtual_texture_levels(this->size, page);
+    if (this->levels > VIRTUAL_TEXTURE_LEVELS_MAX)
+        goto error;
+
+    uint32_t count = 0;
+    for (int level = 0; level < this->levels; level++) {
+        Vec2i size = virtual_texture_level_size(this->size, level);
+        this->level_first[level] = count;
+        this->level_pages[level] = (size.x + page - 1) >> this->page_shift;
+        count += this->level_pages[level] * ((size.y + page - 1) >> this->page_shift);
+    }
+    if (count > pages_capacity ||
+        VIRTUAL_TEXTURE_HEADER + count * virtual_texture_page_bytes(this) > this->file_size)
+        goto error;
+
+    this->pages = pages;
+    this->pages_count = count;
+    for (uint32_t i = 0; i < count; i++) {
+        pages[i].slot = VIRTUAL_TEXTURE_ABSENT;
+#ifdef PINGO_THREADS
+        atomic_init(&pages[i].used, 0);
+#else
+        pages[i].used = 0;
+#endif
+    }
+
+    this->slots = slots;
+    this->slots_pixels = slots_pixels;
+    this->slots_count = slots_count;
+    for (uint32_t i = 0; i < slots_count; i++)
+        slots[i] = VIRTUAL_TEXTURE_ABSENT;
+
+    this->frame = 1;
+    this->loaded = 0;
+    this->missing = 0;
+
+    //The coarsest level is the last page, the fallback of every other
+    if (!virtual_texture_load(this, count - 1, 0))
+        goto error;
+
+    *texture = (Texture){
+        .size = this->size,
+        .format = TEXTURE_VIRTUAL,
+        .virtual_texture = this,
+        .mipmaps_count = this->levels - 1,
+        .filter = TEXTURE_NEAREST,
+        .layout = TEXTURE_LINEAR,
+    };
+    this->texture = texture;
+    return OK;
+
+error:
+    virtual_texture_destroy(this);
+    return INIT_ERROR;
+}
+
+// Slot of the least recently used page, VIRTUAL_TEXTURE_ABSENT when every
+// page was used during the frame
+static uint32_t virtual_texture_victim(VirtualTexture *this)
+{
+    uint32_t victim = VIRTUAL_TEXTURE_ABSENT;
+    uint32_t oldest = this->frame;
+    for (uint32_t slot = 1; slot < this->slots_count; slot++) {
+        if (this->slots[slot] == VIRTUAL_TEXTURE_ABSENT)
+            return slot;
+        uint32_t used = virtual_page_used(&this->pages[this->slots[slot]]);
+        if (used < oldest) {
+            oldest = used;
+            victim = slot;
+        }
+    }
+    return victim;
+}
+
+int virtual_texture_update(VirtualTexture *this, uint32_t max_loads)
+{
+    IF_NULL_RETURN(this, RENDER_ERROR);
+
+    this->loaded = 0;
+    this->missing = 0;
+
+    //Coarse levels first, they are the fallback of the finer ones
+    for (int level = this->levels - 1; level >= 0; level--) {
+        uint32_t end = level + 1 < this->levels ? this->level_first[level + 1] : this->pages_count;
+        for (uint32_t page = this->level_first[level]; page < end; page++) {
+            VirtualPage *p = &this->pages[page];
+            if (virtual_page_used(p) != this->frame || p->slot != VIRTUAL_TEXTURE_ABSENT)
+                continue;
+
+            uint32_t slot = this->loaded < max_loads ? virtual_texture_victim(this) : VIRTUAL_TEXTURE_ABSENT;
+            if (slot == VIRTUAL_TEXTURE_ABSENT) {
+                this->missing++;
+                continue;
+            }
+
+            if (this->slots[slot] != VIRTUAL_TEXTURE_ABSENT)
+                this->pages[this->slots[slot]].slot = VIRTUAL_TEXTURE_ABSENT;
+            this->slots[slot] = VIRTUAL_TEXTURE_ABSENT;
+            if (!virtual_texture_load(this, page, slot))
+                return RENDER_ERROR;
+            this->loaded++;
+        }
+    }
+
+    this->frame++;
+    return OK;
+}
+
+int virtual_texture_destroy(VirtualTexture *this)
+{
+    IF_NULL_RETURN(this, SET_ERROR);
+
+#ifdef VIRTUAL_TEXTURE_MMAP
+    if (this->file != 0)
+        munmap((void *)this->file, this->file_size);
+#endif
+    if (this->stream != 0)
+        fclose(this->stream);
+    this->file = 0;
+    this->stream = 0;
+    return OK;
+}
+
+static Pixel virtual_texture_source_texel(Texture *source, int level, Vec2i size, int32_t x, int32_t y)
+{
+    x = MIN(x, size.x - 1);
+    y = MIN(y, size.y - 1);
+    if (level == 0)
+        return texture_fetch(source, x, y);
+    return source->mipmaps[level - 1][texture_index(source, size, x, y)];
+}
+
+int virtual_texture_write(Texture *source, int32_t page, const char *filename)
+{
+    IF_NULL_RETURN(source, INIT_ERROR);
+    IF_NULL_RETURN(filename, INIT_ERROR);
+
+    if (page <= 0 || (page & (page - 1)) != 0)
+        return INIT_ERROR;
+
+    int levels = virtual_texture_levels(source->size, page);
+    if (levels > VIRTUAL_TEXTURE_LEVELS_MAX || source->mipmaps_count < levels - 1)
+        return INIT_ERROR;
+
+    FILE *file = fopen(filename, "wb");
+    IF_NULL_RETURN(file, INIT_ERROR);
+
+    uint32_t header[4] = {0, source->size.x, source->size.y, page};
+    memcpy(header, virtual_texture_magic, 4);
+    fwrite(header, sizeof(header), 1, file);
+
+    //Pages past the edges of a level repeat its last row and column
+    for (int level = 0; level < levels; level++) {
+        Vec2i size = virtual_texture_level_size(source->size, level);
+        for (int32_t py = 0; py < size.y; py += page) {
+            for (int32_t px = 0; px < size.x; px += page) {
+                for (int32_t y = py; y < py + page; y++) {
+                    for (int32_t x = px; x < px + page; x++) {
+                        Pixel texel = virtual_texture_source_texel(source, level, size, x, y);
+                        fwrite(&texel, sizeof(texel), 1, file);
+                    }
+                }
+            }
+        }
+    }
+
+    bool failed = ferror(file);
+    return fclose(file) == 0 && !failed ? OK : INIT_ERROR;
+}
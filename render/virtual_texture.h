@@ -0,0 +1,151 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "pixel.h"
+#include "texture.h"
+
+#ifdef PINGO_THREADS
+#include <stdatomic.h>
+#endif
+
+/**
+ * Virtual texturing.
+ *
+ * A virtual texture is split into square pages, at every mipmap level, and
+ * only the pages sampled lately are resident: the texture can be far larger
+ * than memory. The pages live in a file, mapped in memory, and are copied
+ * into a fixed number of slots when needed.
+ *
+ * Fetching a texel stamps its page with the current frame. A page that is
+ * not resident is sampled from the next coarser level that is, its pages
+ * being stamped as well; the coarsest level fits in a single page that
+ * always stays resident, so something is shown until the page arrives.
+ * Between frames virtual_texture_update loads the pages stamped during the
+ * frame that are not resident, the coarser levels first, evicting the
+ * least recently stamped pages.
+ *
+ * The texture is sampled through a Texture of format TEXTURE_VIRTUAL, set
+ * up by virtual_texture_init, with its mipmaps_count set to the levels of
+ * the file: materials use it like any texture, and select levels with the
+ * texture filter. Stamps are written by every thread rasterizing, with the
+ * same value: with PINGO_THREADS they are relaxed atomics. Stamps order
+ * nothing, virtual_texture_update must not run while rendering.
+ *
+ * The file is written by virtual_texture_write: a 16 bytes header, "PVT1"
+ * then the width, the height and the page size as native 32 bit integers,
+ * followed by the pages of every level, page after page in rows, each page
+ * pixels in rows. The pixels are in the format of Pixel, loading a page is
+ * a copy.
+ */
+
+#define VIRTUAL_TEXTURE_LEVELS_MAX (TEXTURE_MIPMAPS_MAX + 1)
+#define VIRTUAL_TEXTURE_ABSENT UINT32_MAX
+#define VIRTUAL_TEXTURE_HEADER 16
+
+// Upper bound of the pages of a width x height texture, every level
+// included, for a page size of page texels
+#define VIRTUAL_TEXTURE_PAGES_COUNT(width, height, page)                       \
+  (((width) / (page) + 1) * ((height) / (page) + 1) * 4 / 3 +                  \
+   2 * ((width) + (height)) / (page) + VIRTUAL_TEXTURE_LEVELS_MAX)
+
+typedef struct VirtualPage {
+  uint32_t slot; // VIRTUAL_TEXTURE_ABSENT when not resident
+#ifdef PINGO_THREADS
+  atomic_uint used; // Frame it was last sampled
+#else
+  uint32_t used;
+#endif
+} VirtualPage;
+
+static inline uint32_t virtual_page_used(VirtualPage *page)
+{
+#ifdef PINGO_THREADS
+  return atomic_load_explicit(&page->used, memory_order_relaxed);
+#else
+  return page->used;
+#endif
+}
+
+static inline void virtual_page_set_used(VirtualPage *page, uint32_t frame)
+{
+#ifdef PINGO_THREADS
+  atomic_store_explicit(&page->used, frame, memory_order_relaxed);
+#else
+  page->used = frame;
+#endif
+}
+
+typedef struct VirtualTexture {
+  Texture *texture;
+
+  Vec2i size;
+  int32_t page;        // Page size in texels, a power of two
+  uint32_t page_shift; // log2 of page
+  int levels;
+
+  // First page and pages per row of every level
+  uint32_t level_first[VIRTUAL_TEXTURE_LEVELS_MAX];
+  int32_t level_pages[VIRTUAL_TEXTURE_LEVELS_MAX];
+
+  VirtualPage *pages;
+  uint32_t pages_count;
+
+  // Page held by each slot, the first holds the coarsest level for good
+  uint32_t *slots;
+  Pixel *slots_pixels;
+  uint32_t slots_count;
+
+  uint32_t frame;
+  uint32_t loaded;  // Pages loaded by the last update
+  uint32_t missing; // Pages still missing after the last update
+
+  // The file, mapped or open
+  const uint8_t *file;
+  size_t file_size;
+  FILE *stream;
+} VirtualTexture;
+
+/// Opens the file written by virtual_texture_write and sets texture up to
+/// sample it. pages must hold pages_capacity elements, at least
+/// VIRTUAL_TEXTURE_PAGES_COUNT of the texture, slots slots_count elements
+/// and slots_pixels slots_count pages of pixels. slots_count must be at
+/// least 2
+extern int virtual_texture_init(VirtualTexture *this, Texture *texture, const char *filename,
+                                VirtualPage *pages, uint32_t pages_capacity,
+                                uint32_t *slots, Pixel *slots_pixels, uint32_t slots_count);
+
+/// Loads at most max_loads of the pages sampled during the frame that are
+/// not resident, and starts the next frame
+extern int virtual_texture_update(VirtualTexture *this, uint32_t max_loads);
+
+/// Closes the file
+extern int virtual_texture_destroy(VirtualTexture *this);
+
+/// Writes source, whose mipmaps must go down to a single page, to filename
+/// as a virtual texture of pages of page texels
+extern int virtual_texture_write(Texture *source, int32_t page, const char *filename);
+
+/// Texel x/y of a level, from the finest resident level at or above it
+static inline Pixel virtual_texture_fetch(VirtualTexture *this, int level, int32_t x, int32_t y)
+{
+  uint32_t mask = this->page - 1;
+  for (;;) {
+    uint32_t index = this->level_first[level] + (x >> this->page_shift) +
+                     (y >> this->page_shift) * this->level_pages[level];
+    VirtualPage *page = &this->pages[index];
+    if (virtual_page_used(page) != this->frame)
+      virtual_page_set_used(page, this->frame);
+    if (page->slot != VIRTUAL_TEXTURE_ABSENT) {
+      uint32_t offset = ((y & mask) << this->page_shift) + (x & mask);
+      return this->slots_pixels[(page->slot << (2 * this->page_shift)) + offset];
+    }
+    //Odd sizes round down, the last texel has no parent of its own
+    level++;
+    int32_t width = this->size.x >> level, height = this->size.y >> level;
+    x = x >> 1 < width ? x >> 1 : (width > 0 ? width - 1 : 0);
+    y = y >> 1 < height ? y >> 1 : (height > 0 ? height - 1 : 0);
+  }
+}
@@ -0,0 +1,63 @@
+#include "visibility.h"
+#include "renderer.h"
+#include "state.h"
+
+#include <string.h>
+
+int visibility_init(Visibility *this, uint32_t *ids, Triangle *triangles,
+                    uint32_t triangles_capacity)
+{
+    IF_NULL_RETURN(this, INIT_ERROR);
+    IF_NULL_RETURN(ids, INIT_ERROR);
+    IF_NULL_RETURN(triangles, INIT_ERROR);
+
+    if (triangles_capacity == 0)
+        return INIT_ERROR;
+
+    this->ids = ids;
+    this->triangles = triangles;
+    this->triangles_capacity = triangles_capacity;
+    this->triangles_count = 0;
+
+    return OK;
+}
+
+void visibility_clear(Visibility *this, Renderer *r)
+{
+    int pixels = r->framebuffer.size.x * r->framebuffer.size.y;
+    memset(this->ids, VISIBILITY_EMPTY, pixels * sizeof(uint32_t));
+    this->triangles_count = 0;
+}
+
+uint32_t visibility_add_triangle(Visibility *this, const Triangle *t)
+{
+    if (this->triangles_count == this->triangles_capacity)
+        return VISIBILITY_EMPTY;
+
+    this->triangles[this->triangles_count] = *t;
+    this->triangles[this->triangles_count].id = this->triangles_count + 1;
+    return ++this->triangles_count;
+}
+
+void visibility_resolve(Visibility *this, Renderer *r)
+{
+    if (this->triangles_count == 0)
+        return;
+
+    const Vec2i size = r->framebuffer.size;
+    for (int32_t y = 0; y < size.y; y++) {
+        uint32_t *row = &this->ids[y * size.x];
+        //Runs of pixels of the same triangle are shaded with one setup
+        for (int32_t x = 0; x < size.x;) {
+            uint32_t id = row[x];
+            int32_t end = x + 1;
+            while (end < size.x && row[end] == id)
+                end++;
+            if (id != VISIBILITY_EMPTY)
+                triangle_shade_span(r, &this->triangles[id - 1], x, end, y);
+            x = end;
+        }
+    }
+
+    visibility_clear(this, r);
+}
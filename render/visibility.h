@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "triangle.h"
+
+/**
+ * Visibility buffer (deferred texturing) render mode.
+ *
+ * While triangles are rasterized only depth and the id of the visible
+ * triangle are written for each pixel, the id being an index in a table of
+ * the setup triangles drawn during the frame, which also carry the object
+ * material. The resolve pass then shades every covered pixel once, rebuilding
+ * its barycentric coordinates from the triangle, so texturing and lighting
+ * cost follows the resolution instead of the overdraw. The pixels of a row
+ * holding the same id are shaded as a span, with one triangle setup.
+ *
+ * Buffers are provided by the caller. When the table is full the pixels drawn
+ * so far are resolved and the table starts over.
+ */
+
+#define VISIBILITY_EMPTY 0
+
+typedef struct Visibility {
+  uint32_t *ids; // One per pixel, triangle index + 1 or VISIBILITY_EMPTY
+  Triangle *triangles;
+  uint32_t triangles_capacity;
+  uint32_t triangles_count;
+} Visibility;
+
+/// ids must hold one element per framebuffer pixel
+extern int visibility_init(Visibility *this, uint32_t *ids, Triangle *triangles,
+                           uint32_t triangles_capacity);
+
+/// Clears the ids and the triangle table
+extern void visibility_clear(Visibility *this, Renderer *r);
+
+/// Stores a triangle in the table and returns its id, or VISIBILITY_EMPTY
+/// when the table is full and has to be resolved first
+extern uint32_t visibility_add_triangle(Visibility *this, const Triangle *t);
+
+/// Shades every pixel holding an id, then clears the buffer
+extern void visibility_resolve(Visibility *this, Renderer *r);